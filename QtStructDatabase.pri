@@ -1,29 +1,62 @@
 include($$PWD/QtTupleConversions/QtTupleConversions.pri)
 #include($$PWD/QtMultiThread/QtMultiThread.pri)
 QT += sql
+# Link system SQLite for incremental online backup and reads
+# without QVariant, otherwise backup is made by VACUUM INTO.
+# Connection handles of QSQLITE driver are passed to linked
+# SQLite, so Qt must be built with -system-sqlite. Versions are
+# compared at run time and direct access is disabled if they differ
+qtstructdatabase_system_sqlite {
+    DEFINES += QTSTRUCTDATABASE_SYSTEM_SQLITE
+    LIBS += -lsqlite3
+}
 HEADERS += \
     $$PWD/private/asyncdatabase.h \
+    $$PWD/private/connectioncache.h \
     $$PWD/private/databaserecord.h \
     $$PWD/private/databasetableviewmodel.h \
     $$PWD/private/databaseviewmodeldetail.h \
-    $$PWD/private/databaseviewmodeldetail_vector.h \
+    $$PWD/private/databaseviewmodeldetail_deque.h \
     $$PWD/private/eventdatabasedetail.h \
     $$PWD/private/eventdatabaseprivate.h \
+    $$PWD/private/guitaskqueue.h \
+    $$PWD/private/mpscqueue.h \
+    $$PWD/private/pagesizer.h \
+    $$PWD/private/removalnotifier.h \
+    $$PWD/private/sqlitebackup.h \
+    $$PWD/private/stringdictionary.h \
+    $$PWD/private/task.h \
     $$PWD/private/taskedlistmodel.h \
     $$PWD/private/taskedobject.h \
     $$PWD/private/workerthread.h \
+    $$PWD/columnarsnapshot.h \
+    $$PWD/columntraits.h \
+    $$PWD/compressed.h \
     $$PWD/database.h \
     $$PWD/database_detail.h \
+    $$PWD/databasefanout.h \
+    $$PWD/databaseoptions.h \
     $$PWD/databaseviewmodel.h \
     $$PWD/eventdatabase.h \
     $$PWD/eventdatabaserecord.h \
-    $$PWD/filter.h
+    $$PWD/filter.h \
+    $$PWD/interned.h \
+    $$PWD/partitionpolicy.h \
+    $$PWD/timestamp.h
 
 SOURCES += \
+    $$PWD/private/connectioncache.cpp \
     $$PWD/private/eventdatabaseprivate.cpp \
+    $$PWD/private/guitaskqueue.cpp \
+    $$PWD/private/pagesizer.cpp \
+    $$PWD/private/removalnotifier.cpp \
+    $$PWD/private/sqlitebackup.cpp \
+    $$PWD/private/stringdictionary.cpp \
     $$PWD/private/taskedlistmodel.cpp \
     $$PWD/private/taskedobject.cpp \
-    $$PWD/private/workerthread.cpp
+    $$PWD/private/workerthread.cpp \
+    $$PWD/columnarsnapshot.cpp \
+    $$PWD/databaseoptions.cpp
 OTHER_FILES += \
     $$PWD/README.md
 
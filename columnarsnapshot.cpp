@@ -0,0 +1,440 @@
+#include "columnarsnapshot.h"
+
+#include <cstring>
+
+#include <QDebug>
+
+using namespace ColumnarSnapshotDetail;
+
+namespace {
+const char snapshotMagic[8] = { 'Q', 'S', 'D', 'C', 'O', 'L', 'S', '\0' };
+/*
+ * Bytes of column buffered in memory before written to spill file
+ */
+const int spillBufferSize = 256 * 1024;
+
+qint64 aligned(qint64 offset) {
+    return (offset + dataAlignment - 1) / dataAlignment * dataAlignment;
+}
+
+bool writePadding(QFile& file, qint64 offset) {
+    const auto padding = aligned(offset) - offset;
+    return padding == 0 || file.write(QByteArray(int(padding), '\0')) == padding;
+}
+
+/*
+ * Appends whole content of from to to in chunks of spillBufferSize
+ */
+bool copyFile(QFile& from, QFile& to) {
+    if (!from.seek(0)) {
+        return false;
+    }
+    QByteArray chunk;
+    while (!from.atEnd()) {
+        chunk = from.read(spillBufferSize);
+        if (chunk.isEmpty() || to.write(chunk) != chunk.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+/* ******************************************************************
+ * ColumnarWriter
+ * ******************************************************************
+ */
+
+int ColumnarWriter::addColumn(const QString& name, ColumnType type, int elementSize) {
+    Column column;
+    column.name = name;
+    column.type = type;
+    column.elementSize = elementSize;
+    column.buffer.reserve(spillBufferSize);
+    column.spill = openSpill();
+    if (type == ColumnType::Blob) {
+        column.bytesBuffer.reserve(spillBufferSize);
+        column.bytesSpill = openSpill();
+    }
+    _columns.push_back(std::move(column));
+    return int(_columns.size()) - 1;
+}
+
+void ColumnarWriter::append(int column, const void* value, int size) {
+    auto& c = _columns.at(size_t(column));
+    Q_ASSERT(size == c.elementSize);
+    c.buffer.append(static_cast<const char*>(value), size);
+    c.dataSize += quint64(size);
+    if (c.buffer.size() >= spillBufferSize) {
+        flush(c);
+    }
+}
+
+void ColumnarWriter::appendString(int column, const QString& value) {
+    auto& c = _columns.at(size_t(column));
+    auto it = c.ids.constFind(value);
+    quint32 id;
+    if (it == c.ids.constEnd()) {
+        id = quint32(c.dictionary.size());
+        c.ids.insert(value, id);
+        c.dictionary.push_back(value);
+        c.textSize += quint64(value.size());
+    }
+    else {
+        id = it.value();
+    }
+    append(column, &id, int(sizeof(id)));
+}
+
+void ColumnarWriter::appendBlob(int column, const QByteArray& value) {
+    auto& c = _columns.at(size_t(column));
+    Q_ASSERT(c.type == ColumnType::Blob);
+    c.bytesBuffer.append(value);
+    c.bytesSize += quint64(value.size());
+    if (c.bytesBuffer.size() >= spillBufferSize) {
+        flush(c.bytesBuffer, c.bytesSpill.get());
+    }
+    const auto end = c.bytesSize;
+    append(column, &end, int(sizeof(end)));
+}
+
+void ColumnarWriter::finishRow() {
+    ++_rowCount;
+}
+
+bool ColumnarWriter::write(const QString& path) {
+    for (auto& c : _columns) {
+        flush(c);
+    }
+    if (_failed) {
+        qDebug() << "can not write spill files of snapshot" << path;
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "can not open snapshot" << path << file.errorString();
+        return false;
+    }
+
+    FileHeader fileHeader;
+    std::memset(&fileHeader, 0, sizeof(fileHeader));
+    std::memcpy(fileHeader.magic, snapshotMagic, sizeof(snapshotMagic));
+    fileHeader.version = formatVersion;
+    fileHeader.byteOrder = byteOrderMark;
+    fileHeader.rowCount = _rowCount;
+    fileHeader.columnCount = quint32(_columns.size());
+
+    // Layout: headers, names, then aligned columns with dictionaries
+    std::vector<ColumnHeader> headers(_columns.size());
+    std::vector<QByteArray> names;
+    qint64 offset = qint64(sizeof(FileHeader))
+            + qint64(sizeof(ColumnHeader) * _columns.size());
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        names.push_back(_columns.at(i).name.toUtf8());
+        auto& h = headers.at(i);
+        std::memset(&h, 0, sizeof(h));
+        h.nameOffset = quint64(offset);
+        h.nameSize = quint32(names.back().size());
+        offset += names.back().size();
+    }
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        const auto& c = _columns.at(i);
+        auto& h = headers.at(i);
+        h.type = quint32(c.type);
+        h.elementSize = quint32(c.elementSize);
+        offset = aligned(offset);
+        h.dataOffset = quint64(offset);
+        h.dataSize = c.dataSize;
+        offset += qint64(c.dataSize);
+        if (c.type == ColumnType::String) {
+            offset = aligned(offset);
+            h.dictionaryOffset = quint64(offset);
+            h.dictionaryCount = quint64(c.dictionary.size());
+            offset += qint64((c.dictionary.size() + 1) * sizeof(quint64)
+                             + c.textSize * sizeof(char16_t));
+        }
+        else if (c.type == ColumnType::Blob) {
+            offset = aligned(offset);
+            h.dictionaryOffset = quint64(offset);
+            h.dictionaryCount = c.bytesSize;
+            offset += qint64(c.bytesSize);
+        }
+    }
+
+    bool ok = file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader))
+            == qint64(sizeof(fileHeader));
+    ok = ok && file.write(reinterpret_cast<const char*>(headers.data()),
+                          qint64(sizeof(ColumnHeader) * headers.size()))
+            == qint64(sizeof(ColumnHeader) * headers.size());
+    for (const auto& name : names) {
+        ok = ok && file.write(name) == name.size();
+    }
+    for (size_t i = 0; ok && i < _columns.size(); ++i) {
+        const auto& c = _columns.at(i);
+        ok = writePadding(file, file.pos()) && copyFile(*c.spill, file);
+        if (ok && c.type == ColumnType::String) {
+            std::vector<quint64> offsets;
+            offsets.reserve(c.dictionary.size() + 1);
+            quint64 units = 0;
+            for (const auto& s : c.dictionary) {
+                offsets.push_back(units);
+                units += quint64(s.size());
+            }
+            offsets.push_back(units);
+            const auto offsetsSize = qint64(offsets.size() * sizeof(quint64));
+            ok = writePadding(file, file.pos())
+                    && file.write(reinterpret_cast<const char*>(offsets.data()),
+                                  offsetsSize) == offsetsSize;
+            for (size_t j = 0; ok && j < c.dictionary.size(); ++j) {
+                const auto& s = c.dictionary.at(j);
+                const auto size = qint64(s.size()) * qint64(sizeof(char16_t));
+                ok = file.write(reinterpret_cast<const char*>(s.utf16()), size) == size;
+            }
+        }
+        else if (ok && c.type == ColumnType::Blob) {
+            ok = writePadding(file, file.pos()) && copyFile(*c.bytesSpill, file);
+        }
+    }
+    if (!ok) {
+        qDebug() << "can not write snapshot" << path << file.errorString();
+        file.close();
+        file.remove();
+    }
+    return ok;
+}
+
+/* ******************************************************************
+ * ColumnarWriter private
+ * ******************************************************************
+ */
+
+void ColumnarWriter::flush(QByteArray& buffer, QTemporaryFile* spill) {
+    if (buffer.isEmpty()) {
+        return;
+    }
+    if (!_failed && spill->write(buffer) != buffer.size()) {
+        qDebug() << "can not write spill file" << spill->errorString();
+        _failed = true;
+    }
+    // Reserved capacity is kept
+    buffer.resize(0);
+}
+
+void ColumnarWriter::flush(Column& column) {
+    flush(column.buffer, column.spill.get());
+    if (column.bytesSpill) {
+        flush(column.bytesBuffer, column.bytesSpill.get());
+    }
+}
+
+std::unique_ptr<QTemporaryFile> ColumnarWriter::openSpill() {
+    std::unique_ptr<QTemporaryFile> spill(new QTemporaryFile());
+    if (!spill->open()) {
+        qDebug() << "can not open spill file" << spill->errorString();
+        _failed = true;
+    }
+    return spill;
+}
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+ColumnarSnapshot::ColumnarSnapshot()
+    : _file()
+    , _data{ nullptr }
+    , _size{ 0 }
+    , _header{ nullptr }
+{}
+
+ColumnarSnapshot::~ColumnarSnapshot() {
+    close();
+}
+
+bool ColumnarSnapshot::open(const QString& path) {
+    close();
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        qDebug() << "can not open snapshot" << path << _file.errorString();
+        return false;
+    }
+    _size = _file.size();
+    _data = _size >= qint64(sizeof(FileHeader)) ? _file.map(0, _size) : nullptr;
+    if (_data == nullptr) {
+        qDebug() << "can not map snapshot" << path;
+        close();
+        return false;
+    }
+    _header = reinterpret_cast<const FileHeader*>(_data);
+    bool valid = std::memcmp(_header->magic, snapshotMagic, sizeof(snapshotMagic)) == 0
+            && _header->version >= minFormatVersion
+            && _header->version <= formatVersion
+            && _header->byteOrder == byteOrderMark
+            && qint64(sizeof(FileHeader))
+                + qint64(sizeof(ColumnHeader)) * qint64(_header->columnCount) <= _size;
+    const auto size = quint64(_size);
+    for (auto i = 0; valid && i < columnCount(); ++i) {
+        const auto h = header(i);
+        valid = h->nameOffset <= size && h->nameSize <= size - h->nameOffset
+                && h->elementSize != 0
+                && h->dataOffset % quint64(dataAlignment) == 0
+                && h->dataOffset <= size && h->dataSize <= size - h->dataOffset
+                && h->dataSize / h->elementSize == _header->rowCount
+                && h->dataSize % h->elementSize == 0;
+        if (valid && h->type == quint32(ColumnType::Blob)) {
+            valid = h->elementSize == sizeof(quint64) && blobValid(h);
+            continue;
+        }
+        if (valid && h->dictionaryCount != 0) {
+            valid = h->dictionaryOffset % quint64(dataAlignment) == 0
+                    && h->dictionaryOffset <= size
+                    && h->dictionaryCount < (size - h->dictionaryOffset) / sizeof(quint64);
+        }
+        if (valid && h->dictionaryCount != 0) {
+            const auto offsetsEnd = h->dictionaryOffset
+                    + (h->dictionaryCount + 1) * sizeof(quint64);
+            const auto offsets = reinterpret_cast<const quint64*>(
+                        _data + h->dictionaryOffset);
+            const auto textSize = offsets[h->dictionaryCount];
+            // Every entry must lie inside text, so strings are never read past file end
+            valid = offsets[0] == 0
+                    && textSize <= (size - offsetsEnd) / sizeof(char16_t);
+            for (quint64 j = 0; valid && j < h->dictionaryCount; ++j) {
+                valid = offsets[j] <= offsets[j + 1];
+            }
+        }
+    }
+    if (!valid) {
+        qDebug() << "wrong snapshot format" << path;
+        close();
+    }
+    return valid;
+}
+
+void ColumnarSnapshot::close() {
+    if (_data != nullptr) {
+        _file.unmap(const_cast<uchar*>(_data));
+    }
+    _file.close();
+    _data = nullptr;
+    _size = 0;
+    _header = nullptr;
+}
+
+bool ColumnarSnapshot::isOpen() const {
+    return _header != nullptr;
+}
+
+qint64 ColumnarSnapshot::rowCount() const {
+    return isOpen() ? qint64(_header->rowCount) : 0;
+}
+
+int ColumnarSnapshot::columnCount() const {
+    return isOpen() ? int(_header->columnCount) : 0;
+}
+
+QString ColumnarSnapshot::columnName(int column) const {
+    const auto h = header(column);
+    if (h == nullptr) {
+        return QString();
+    }
+    return QString::fromUtf8(
+                reinterpret_cast<const char*>(_data + h->nameOffset),
+                int(h->nameSize));
+}
+
+ColumnarSnapshot::ColumnType ColumnarSnapshot::columnType(int column) const {
+    const auto h = header(column);
+    return h == nullptr ? ColumnType::Unknown : ColumnType(h->type);
+}
+
+int ColumnarSnapshot::columnIndex(const QString& name) const {
+    for (auto i = 0; i < columnCount(); ++i) {
+        if (columnName(i) == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ColumnSpan<qint64> ColumnarSnapshot::rowIds() const {
+    return column<qint64>(0);
+}
+
+int ColumnarSnapshot::dictionarySize(int column) const {
+    const auto h = header(column);
+    return h == nullptr ? 0 : int(h->dictionaryCount);
+}
+
+QString ColumnarSnapshot::dictionaryValue(int column, quint32 id) const {
+    const auto h = header(column);
+    if (h == nullptr || id >= h->dictionaryCount) {
+        return QString();
+    }
+    const auto offsets = reinterpret_cast<const quint64*>(_data + h->dictionaryOffset);
+    const auto text = reinterpret_cast<const QChar*>(
+                offsets + h->dictionaryCount + 1);
+    return QString::fromRawData(
+                text + offsets[id], int(offsets[id + 1] - offsets[id]));
+}
+
+QByteArray ColumnarSnapshot::blob(int column, qint64 row) const {
+    const auto h = header(column);
+    const auto ends = this->column<quint64>(column);
+    if (h == nullptr || h->type != quint32(ColumnType::Blob)
+            || row < 0 || row >= ends.size()) {
+        return QByteArray();
+    }
+    const auto begin = row == 0 ? 0u : ends[row - 1];
+    return QByteArray::fromRawData(
+                reinterpret_cast<const char*>(_data + h->dictionaryOffset + begin),
+                int(ends[row] - begin));
+}
+
+QString ColumnarSnapshot::string(int column, qint64 row) const {
+    const auto ids = this->column<quint32>(column);
+    if (row < 0 || row >= ids.size()) {
+        return QString();
+    }
+    return dictionaryValue(column, ids[row]);
+}
+
+/* ******************************************************************
+ * Private
+ * ******************************************************************
+ */
+
+const ColumnHeader* ColumnarSnapshot::header(int column) const {
+    if (column < 0 || column >= columnCount()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const ColumnHeader*>(_data + sizeof(FileHeader)) + column;
+}
+
+bool ColumnarSnapshot::blobValid(const ColumnHeader* h) const {
+    const auto size = quint64(_size);
+    if (h->dictionaryOffset % quint64(dataAlignment) != 0
+            || h->dictionaryOffset > size
+            || h->dictionaryCount > size - h->dictionaryOffset) {
+        return false;
+    }
+    // Every value must lie inside bytes of column and fit in QByteArray
+    const auto ends = reinterpret_cast<const quint64*>(_data + h->dataOffset);
+    quint64 begin = 0u;
+    for (quint64 row = 0; row < _header->rowCount; ++row) {
+        if (ends[row] < begin || ends[row] - begin > quint64(std::numeric_limits<int>::max())) {
+            return false;
+        }
+        begin = ends[row];
+    }
+    return begin == h->dictionaryCount;
+}
+
+const void* ColumnarSnapshot::columnData(int column, int elementSize) const {
+    const auto h = header(column);
+    if (h == nullptr || h->elementSize != quint32(elementSize)) {
+        return nullptr;
+    }
+    return _data + h->dataOffset;
+}
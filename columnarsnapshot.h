@@ -0,0 +1,500 @@
+#ifndef COLUMNARSNAPSHOT_H
+#define COLUMNARSNAPSHOT_H
+
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QTemporaryFile>
+
+#include "compressed.h"
+#include "database.h"
+
+/**
+ * @file
+ * @brief Flat binary columnar snapshot of database table
+ *
+ * File layout, all numbers in host byte order:
+ * FileHeader, ColumnHeader for each column, column names,
+ * then data of each column aligned to dataAlignment bytes.
+ * Column 0 holds row ids, column i + 1 holds member i of struct.
+ * QString columns hold quint32 ids of dictionary, dictionary is
+ * quint64 offsets[count + 1] in UTF-16 units followed by UTF-16 text.
+ * Blob columns (QByteArray, Compressed) hold quint64 end offset
+ * of each value, bytes of all values follow at dictionaryOffset,
+ * dictionaryCount is their total size. Compressed values are
+ * stored decompressed, Compressed<QString> as UTF-8.
+ * PackedArray columns hold std::array elements as they are in memory
+ */
+namespace ColumnarSnapshotDetail {
+
+const quint32 formatVersion = 2;
+/*
+ * Oldest version read, version 1 has no types added by version 2
+ */
+const quint32 minFormatVersion = 1;
+const quint32 byteOrderMark = 0x01020304;
+const qint64 dataAlignment = 64;
+/*
+ * Stored value of invalid QDateTime
+ */
+const qint64 invalidDateTime = std::numeric_limits<qint64>::min();
+
+enum class ColumnType : quint32 {
+    Unknown = 0,
+    Int32,
+    Int64,
+    Double,
+    Bool,
+    String,
+    DateTime,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    UInt32,
+    Float,
+    Blob,
+    PackedArray
+};
+
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint64 rowCount;
+    quint32 columnCount;
+    quint32 reserved;
+};
+static_assert(sizeof(FileHeader) == 32, "unexpected padding");
+
+struct ColumnHeader {
+    quint32 type;
+    quint32 elementSize;
+    quint64 nameOffset;
+    quint32 nameSize;
+    quint32 reserved;
+    quint64 dataOffset;
+    quint64 dataSize;
+    quint64 dictionaryOffset;
+    quint64 dictionaryCount;
+    quint64 reserved2;
+};
+static_assert(sizeof(ColumnHeader) == 64, "unexpected padding");
+
+/**
+ * @brief The ColumnStorage struct
+ * How member of type T is stored in column.
+ * StoredType is element of column array
+ */
+template <typename T, typename Enable = void>
+struct ColumnStorage {
+    static constexpr ColumnType type = ColumnType::Unknown;
+};
+
+template <>
+struct ColumnStorage<int> {
+    static constexpr ColumnType type = ColumnType::Int32;
+    using StoredType = qint32;
+    static StoredType store(int v) { return v; }
+};
+
+template <>
+struct ColumnStorage<qint64> {
+    static constexpr ColumnType type = ColumnType::Int64;
+    using StoredType = qint64;
+    static StoredType store(qint64 v) { return v; }
+};
+
+template <>
+struct ColumnStorage<quint32> {
+    static constexpr ColumnType type = ColumnType::UInt32;
+    using StoredType = quint32;
+    static StoredType store(quint32 v) { return v; }
+};
+
+template <>
+struct ColumnStorage<double> {
+    static constexpr ColumnType type = ColumnType::Double;
+    using StoredType = double;
+    static StoredType store(double v) { return v; }
+};
+
+template <>
+struct ColumnStorage<float> {
+    static constexpr ColumnType type = ColumnType::Float;
+    using StoredType = float;
+    static StoredType store(float v) { return v; }
+};
+
+template <typename T>
+struct ColumnStorage<T, std::enable_if_t<ColumnTraitsDetail::IsSmallInteger<T>{}>> {
+    static constexpr ColumnType type = sizeof(T) == 1
+            ? (std::is_signed<T>{} ? ColumnType::Int8 : ColumnType::UInt8)
+            : (std::is_signed<T>{} ? ColumnType::Int16 : ColumnType::UInt16);
+    using StoredType = T;
+    static StoredType store(T v) { return v; }
+};
+
+/*
+ * Enum is stored as its underlying integer
+ */
+template <typename T>
+struct ColumnStorage<T, std::enable_if_t<std::is_enum<T>{}>> {
+    using Underlying = ColumnStorage<std::underlying_type_t<T>>;
+    static constexpr ColumnType type = Underlying::type;
+    using StoredType = typename Underlying::StoredType;
+    static StoredType store(T v) {
+        return Underlying::store(std::underlying_type_t<T>(v));
+    }
+};
+
+template <typename T>
+struct ColumnStorage<T, std::enable_if_t<ColumnTraitsDetail::IsPackedArray<T>{}>> {
+    static constexpr ColumnType type = ColumnType::PackedArray;
+    using StoredType = T;
+    static const StoredType& store(const T& v) { return v; }
+};
+
+template <>
+struct ColumnStorage<bool> {
+    static constexpr ColumnType type = ColumnType::Bool;
+    using StoredType = quint8;
+    static StoredType store(bool v) { return v ? 1u : 0u; }
+};
+
+template <>
+struct ColumnStorage<QDateTime> {
+    static constexpr ColumnType type = ColumnType::DateTime;
+    using StoredType = qint64;
+    static StoredType store(const QDateTime& v) {
+        return v.isValid() ? v.toMSecsSinceEpoch() : invalidDateTime;
+    }
+};
+
+template <>
+struct ColumnStorage<Timestamp> {
+    static constexpr ColumnType type = ColumnType::DateTime;
+    using StoredType = qint64;
+    static StoredType store(const Timestamp& v) {
+        return v.isValid() ? v.toMSecsSinceEpoch() : invalidDateTime;
+    }
+};
+
+/*
+ * Values are replaced by ids of dictionary
+ */
+template <>
+struct ColumnStorage<QString> {
+    static constexpr ColumnType type = ColumnType::String;
+    using StoredType = quint32;
+};
+
+template <>
+struct ColumnStorage<Interned<QString>> : ColumnStorage<QString> {};
+
+/*
+ * Values are written to bytes of column, element is end offset
+ */
+template <>
+struct ColumnStorage<QByteArray> {
+    static constexpr ColumnType type = ColumnType::Blob;
+    using StoredType = quint64;
+};
+
+template <typename T, int threshold>
+struct ColumnStorage<Compressed<T, threshold>> : ColumnStorage<QByteArray> {};
+
+/**
+ * @brief The ColumnarWriter class
+ * Streams each column to its own temporary file while rows
+ * are appended, write() copies them into snapshot file.
+ * Only string dictionaries are kept in memory,
+ * so size of snapshot is not limited by memory
+ */
+class ColumnarWriter
+{
+public:
+    int addColumn(const QString& name, ColumnType type, int elementSize);
+
+    void append(int column, const void* value, int size);
+    void appendString(int column, const QString& value);
+    void appendBlob(int column, const QByteArray& value);
+    void finishRow();
+
+    bool write(const QString& path);
+
+private:
+    struct Column {
+        QString name;
+        ColumnType type;
+        int elementSize;
+        /*
+         * Data not yet written to spill file
+         */
+        QByteArray buffer;
+        std::unique_ptr<QTemporaryFile> spill;
+        quint64 dataSize = 0;
+        /*
+         * Bytes of blob column, same as data
+         */
+        QByteArray bytesBuffer;
+        std::unique_ptr<QTemporaryFile> bytesSpill;
+        quint64 bytesSize = 0;
+        QHash<QString, quint32> ids;
+        std::vector<QString> dictionary;
+        /*
+         * Total length of dictionary in UTF-16 units
+         */
+        quint64 textSize = 0;
+    };
+
+    /**
+     * @brief flush
+     * Writes buffer to spill file, keeps reserved capacity of buffer
+     */
+    void flush(QByteArray& buffer, QTemporaryFile* spill);
+    void flush(Column& column);
+    std::unique_ptr<QTemporaryFile> openSpill();
+
+    std::vector<Column> _columns;
+    quint64 _rowCount = 0;
+    bool _failed = false;
+};
+
+template <typename Tuple, typename Sequence>
+struct TupleAppender;
+
+template <typename Tuple, size_t... Is>
+struct TupleAppender<Tuple, std::index_sequence<Is...>> {
+    static void addColumns(ColumnarWriter& writer, const QStringList& names) {
+        ((
+        addColumn<Is>(writer, names.at(int(Is)))
+        ), ...);
+    }
+
+    static void append(ColumnarWriter& writer, const Tuple& tuple) {
+        ((
+        appendValue(writer, int(Is) + 1, std::get<Is>(tuple))
+        ), ...);
+    }
+
+private:
+    template <size_t index>
+    static void addColumn(ColumnarWriter& writer, const QString& name) {
+        using Type = std::decay_t<std::tuple_element_t<index, Tuple>>;
+        using Storage = ColumnStorage<Type>;
+        static_assert(Storage::type != ColumnType::Unknown,
+                      "type of member can not be stored in snapshot");
+        writer.addColumn(
+                    name, Storage::type,
+                    int(sizeof(typename Storage::StoredType)));
+    }
+
+    static void appendValue(ColumnarWriter& writer, int column, const QString& value) {
+        writer.appendString(column, value);
+    }
+
+    static void appendValue(
+            ColumnarWriter& writer, int column, const Interned<QString>& value)
+    {
+        writer.appendString(column, value.value());
+    }
+
+    static void appendValue(ColumnarWriter& writer, int column, const QByteArray& value) {
+        writer.appendBlob(column, value);
+    }
+
+    template <typename V, int threshold>
+    static void appendValue(
+            ColumnarWriter& writer, int column, const Compressed<V, threshold>& value)
+    {
+        writer.appendBlob(column, CompressedDetail::toBytes(value.value()));
+    }
+
+    template <typename Type>
+    static void appendValue(ColumnarWriter& writer, int column, const Type& value) {
+        const auto stored = ColumnStorage<std::decay_t<Type>>::store(value);
+        writer.append(column, &stored, int(sizeof(stored)));
+    }
+};
+
+} // namespace ColumnarSnapshotDetail
+
+/**
+ * @brief The ColumnSpan class
+ * Typed read only view of mapped column
+ */
+template <typename V>
+class ColumnSpan
+{
+public:
+    ColumnSpan() = default;
+    ColumnSpan(const V* data, qint64 size) : _data{ data }, _size{ size } {}
+
+    const V* data() const { return _data; }
+    qint64 size() const { return _size; }
+    bool isEmpty() const { return _size == 0; }
+
+    const V& operator[](qint64 i) const { return _data[i]; }
+    const V* begin() const { return _data; }
+    const V* end() const { return _data + _size; }
+
+private:
+    const V* _data = nullptr;
+    qint64 _size = 0;
+};
+
+/**
+ * @brief The ColumnarSnapshot class
+ * Reads snapshot file written by exportTable.
+ * File is mapped into memory, columns are returned
+ * as spans over mapped data without parsing,
+ * so scans are limited by memory bandwidth only
+ */
+class ColumnarSnapshot
+{
+public:
+    using ColumnType = ColumnarSnapshotDetail::ColumnType;
+
+    ColumnarSnapshot();
+    ~ColumnarSnapshot();
+
+    ColumnarSnapshot(const ColumnarSnapshot&) = delete;
+    ColumnarSnapshot& operator=(const ColumnarSnapshot&) = delete;
+
+    /**
+     * @brief exportTable
+     * Writes records of table passing filter to snapshot file.
+     * Every stored type of Database is exported, see ColumnStorage,
+     * types of own ColumnTraits need ColumnStorage specialization
+     * @return false if read or write failed
+     */
+    template <
+            size_t tableIndex,
+            typename... T,
+            typename FilterType = Filter<
+                typename Conversions::TypeAtT<
+                    Conversions::TypeList<T...>, tableIndex
+                    >,
+                FilterDetail::Blank>
+            >
+    static bool exportTable(
+            Database<T...>& database,
+            const QString& path,
+            FilterType filter = FilterType());
+
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const;
+
+    qint64 rowCount() const;
+    int columnCount() const;
+    QString columnName(int column) const;
+    ColumnType columnType(int column) const;
+    /**
+     * @brief columnIndex
+     * @return index of column with name, -1 if not found
+     */
+    int columnIndex(const QString& name) const;
+
+    /**
+     * @brief column
+     * @param V stored type of column, e.g. qint64 for QDateTime,
+     * quint32 (dictionary ids) for QString, quint64 (end offsets)
+     * for QByteArray and Compressed, std::array for packed arrays
+     * @return empty span if size of V does not match column
+     */
+    template <typename V>
+    ColumnSpan<V> column(int column) const;
+
+    /**
+     * @brief rowIds
+     * @return row ids of exported records
+     */
+    ColumnSpan<qint64> rowIds() const;
+
+    int dictionarySize(int column) const;
+    /**
+     * @brief dictionaryValue
+     * @return string sharing mapped memory,
+     * valid while snapshot is open
+     */
+    QString dictionaryValue(int column, quint32 id) const;
+    QString string(int column, qint64 row) const;
+    /**
+     * @brief blob
+     * @return value of QByteArray or Compressed column sharing
+     * mapped memory, valid while snapshot is open
+     */
+    QByteArray blob(int column, qint64 row) const;
+
+private:
+    const ColumnarSnapshotDetail::ColumnHeader* header(int column) const;
+    /**
+     * @brief blobValid
+     * Checks end offsets and bytes of blob column
+     */
+    bool blobValid(const ColumnarSnapshotDetail::ColumnHeader* h) const;
+    const void* columnData(int column, int elementSize) const;
+
+private:
+    QFile _file;
+    const uchar* _data;
+    qint64 _size;
+    const ColumnarSnapshotDetail::FileHeader* _header;
+
+};
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+template <size_t tableIndex, typename... T, typename FilterType>
+bool ColumnarSnapshot::exportTable(
+        Database<T...>& database,
+        const QString& path,
+        FilterType filter)
+{
+    using Type = typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>;
+    using TupleType = typename StructConversions::StructExtractor<Type>::TupleType;
+    using Appender = ColumnarSnapshotDetail::TupleAppender<
+        TupleType,
+        std::make_index_sequence<StructConversions::StructExtractor<Type>::size>>;
+
+    ColumnarSnapshotDetail::ColumnarWriter writer;
+    writer.addColumn(
+                "_rowid",
+                ColumnarSnapshotDetail::ColumnType::Int64,
+                int(sizeof(qint64)));
+    Appender::addColumns(writer, DatabaseDetail::columnNames<Type>());
+
+    const bool ok = database.template readEach<tableIndex>(
+                [&writer](const DatabaseRecord<Type>& record) {
+        writer.append(0, &record.rowId, int(sizeof(record.rowId)));
+        const Type& t = record;
+        Appender::append(writer, TupleConversions::makeTuple(t));
+        writer.finishRow();
+        return true;
+    }, filter);
+    return ok && writer.write(path);
+}
+
+template <typename V>
+ColumnSpan<V> ColumnarSnapshot::column(int column) const {
+    const auto data = columnData(column, int(sizeof(V)));
+    if (data == nullptr) {
+        return ColumnSpan<V>();
+    }
+    return ColumnSpan<V>(static_cast<const V*>(data), rowCount());
+}
+
+#endif // COLUMNARSNAPSHOT_H
@@ -0,0 +1,275 @@
+#ifndef COLUMNTRAITS_H
+#define COLUMNTRAITS_H
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+#include <QVariant>
+#include <QVariantList>
+
+#include "QtTupleConversions/conversions.h"
+
+namespace ColumnTraitsDetail {
+
+/**
+ * @brief The IsSmallInteger struct
+ * 8 and 16 bit integer types, e.g. quint8, qint16
+ */
+template <typename T>
+struct IsSmallInteger : std::integral_constant<
+        bool,
+        std::is_integral<T>{}
+        && !std::is_same<T, bool>{}
+        && sizeof(T) < sizeof(qint32)
+        > {};
+
+/**
+ * @brief The IsPackedArray struct
+ * Fixed arrays of numbers packed into one BLOB
+ */
+template <typename T>
+struct IsPackedArray : std::false_type {};
+
+template <typename V, size_t N>
+struct IsPackedArray<std::array<V, N>> : std::integral_constant<
+        bool,
+        std::is_arithmetic<V>{} && !std::is_same<V, bool>{}
+        > {};
+
+template <typename T>
+QString numberTypeName() {
+    if constexpr (std::is_floating_point<T>{}) {
+        return sizeof(T) == sizeof(float) ? "float" : "double";
+    }
+    else {
+        return QString(std::is_signed<T>{} ? "qint" : "quint")
+                + QString::number(sizeof(T) * 8);
+    }
+}
+
+inline QString blobLiteral(const QByteArray& value) {
+    return "X'" + QString::fromLatin1(value.toHex()) + "'";
+}
+
+} // namespace ColumnTraitsDetail
+
+/**
+ * @brief The ColumnTraits struct
+ * How member of type T is stored in column.
+ * Default traits use Conversions, specialize traits
+ * to store own type:
+ * - typeName() is part of column name
+ * - sqlTypeName() is type of column in CREATE TABLE
+ * - toStored() returns value bound to query
+ * - fromStored() builds value from selected value
+ * - filterLiteral() returns SQL literal of value for filters
+ * - toDisplay() returns value shown by view models
+ * - optional fromBlob(data, size) builds value stored as BLOB
+ * straight from SQLite statement
+ */
+template <typename T, typename Enable = void>
+struct ColumnTraits {
+    static QString typeName() {
+        return Conversions::typeName<T>();
+    }
+    static QString sqlTypeName() {
+        // TODO static_assert
+        return "Unknown";
+    }
+    static QVariant toStored(const T& value) {
+        return QVariant(Conversions::toStoredDataValue(value));
+    }
+    static T fromStored(const QVariant& value) {
+        return Conversions::fromStoredVariant<T>(value);
+    }
+    static QString filterLiteral(const T& value) {
+        return Conversions::toStoredDataValueString(value);
+    }
+    static QVariant toDisplay(const T& value) {
+        return QVariant(value);
+    }
+};
+
+/*
+ * Stored as epoch milliseconds, NULL for invalid date
+ */
+template <>
+struct ColumnTraits<QDateTime> {
+    static QString typeName() {
+        return Conversions::typeName<QDateTime>();
+    }
+    static QString sqlTypeName() {
+        return "INTEGER";
+    }
+    static QVariant toStored(const QDateTime& value) {
+        return value.isValid() ? QVariant(value.toMSecsSinceEpoch()) : QVariant();
+    }
+    static QDateTime fromStored(const QVariant& value) {
+        return value.isNull()
+                ? QDateTime()
+                : QDateTime::fromMSecsSinceEpoch(value.toLongLong());
+    }
+    static QString filterLiteral(const QDateTime& value) {
+        return value.isValid() ? QString::number(value.toMSecsSinceEpoch()) : "NULL";
+    }
+    static QVariant toDisplay(const QDateTime& value) {
+        return QVariant(value);
+    }
+};
+
+/*
+ * Binary data stored as BLOB without encoding
+ */
+template <>
+struct ColumnTraits<QByteArray> {
+    static QString typeName() {
+        return "QByteArray";
+    }
+    static QString sqlTypeName() {
+        return "BLOB";
+    }
+    static QVariant toStored(const QByteArray& value) {
+        return QVariant(value);
+    }
+    static QByteArray fromStored(const QVariant& value) {
+        return value.toByteArray();
+    }
+    static QString filterLiteral(const QByteArray& value) {
+        return ColumnTraitsDetail::blobLiteral(value);
+    }
+    static QVariant toDisplay(const QByteArray& value) {
+        return QVariant(value);
+    }
+};
+
+/*
+ * 8 and 16 bit integers, SQLite keeps them in 1-2 bytes of record
+ */
+template <typename T>
+struct ColumnTraits<T, std::enable_if_t<ColumnTraitsDetail::IsSmallInteger<T>{}>> {
+    static QString typeName() {
+        return ColumnTraitsDetail::numberTypeName<T>();
+    }
+    static QString sqlTypeName() {
+        return "INTEGER";
+    }
+    static QVariant toStored(T value) {
+        return QVariant(qint64(value));
+    }
+    static T fromStored(const QVariant& value) {
+        return T(value.toLongLong());
+    }
+    static QString filterLiteral(T value) {
+        return QString::number(qint64(value));
+    }
+    static QVariant toDisplay(T value) {
+        return QVariant(qint64(value));
+    }
+};
+
+/*
+ * Float is stored as REAL, exactly converted to double
+ */
+template <>
+struct ColumnTraits<float> {
+    static QString typeName() {
+        return "float";
+    }
+    static QString sqlTypeName() {
+        return "REAL";
+    }
+    static QVariant toStored(float value) {
+        return QVariant(double(value));
+    }
+    static float fromStored(const QVariant& value) {
+        return float(value.toDouble());
+    }
+    static QString filterLiteral(float value) {
+        return QString::number(double(value), 'g', 17);
+    }
+    static QVariant toDisplay(float value) {
+        return QVariant(value);
+    }
+};
+
+/*
+ * Enum is stored as its underlying integer
+ */
+template <typename T>
+struct ColumnTraits<T, std::enable_if_t<std::is_enum<T>{}>> {
+    using Underlying = std::underlying_type_t<T>;
+
+    static QString typeName() {
+        return "enum";
+    }
+    static QString sqlTypeName() {
+        return "INTEGER";
+    }
+    static QVariant toStored(T value) {
+        return QVariant(qint64(Underlying(value)));
+    }
+    static T fromStored(const QVariant& value) {
+        return T(Underlying(value.toLongLong()));
+    }
+    static QString filterLiteral(T value) {
+        return QString::number(qint64(Underlying(value)));
+    }
+    static QVariant toDisplay(T value) {
+        return QVariant(qint64(Underlying(value)));
+    }
+};
+
+/*
+ * Fixed array is packed into one BLOB in host byte order
+ * instead of N columns
+ */
+template <typename T>
+struct ColumnTraits<T, std::enable_if_t<ColumnTraitsDetail::IsPackedArray<T>{}>> {
+    using Value = typename T::value_type;
+
+    static QString typeName() {
+        return ColumnTraitsDetail::numberTypeName<Value>()
+                + "x" + QString::number(std::tuple_size<T>::value);
+    }
+    static QString sqlTypeName() {
+        return "BLOB";
+    }
+    static QByteArray pack(const T& value) {
+        return QByteArray(
+                    reinterpret_cast<const char*>(value.data()),
+                    int(sizeof(Value) * value.size()));
+    }
+    static T fromBlob(const char* data, int size) {
+        T result{};
+        if (data != nullptr) {
+            std::memcpy(result.data(), data,
+                        std::min(size_t(size), sizeof(Value) * result.size()));
+        }
+        return result;
+    }
+    static QVariant toStored(const T& value) {
+        return QVariant(pack(value));
+    }
+    static T fromStored(const QVariant& value) {
+        const auto bytes = value.toByteArray();
+        return fromBlob(bytes.constData(), bytes.size());
+    }
+    static QString filterLiteral(const T& value) {
+        return ColumnTraitsDetail::blobLiteral(pack(value));
+    }
+    static QVariant toDisplay(const T& value) {
+        QVariantList list;
+        list.reserve(int(value.size()));
+        for (const auto& v : value) {
+            list.append(QVariant::fromValue(v));
+        }
+        return list;
+    }
+};
+
+#endif // COLUMNTRAITS_H
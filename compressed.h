@@ -0,0 +1,179 @@
+#ifndef COMPRESSED_H
+#define COMPRESSED_H
+
+#include <type_traits>
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+
+#include "columntraits.h"
+
+namespace CompressedDetail {
+
+/**
+ * @brief Default size in bytes from which value is compressed
+ */
+const int defaultThreshold = 512;
+
+/*
+ * Fastest zlib level, large text payloads still shrink several times
+ */
+const int compressionLevel = 1;
+
+/*
+ * First byte of stored value
+ */
+enum Flag : char {
+    Raw = 0,
+    Zlib = 1
+};
+
+template <typename T>
+QByteArray toBytes(const T& value) {
+    if constexpr (std::is_same<T, QString>{}) {
+        return value.toUtf8();
+    }
+    else {
+        return value;
+    }
+}
+
+template <typename T>
+T fromBytes(const char* data, int size) {
+    if constexpr (std::is_same<T, QString>{}) {
+        return QString::fromUtf8(data, size);
+    }
+    else {
+        return QByteArray(data, size);
+    }
+}
+
+} // namespace CompressedDetail
+
+/**
+ * @brief The Compressed class
+ * Column of QString or QByteArray compressed by qCompress
+ * if value is not smaller than threshold bytes.
+ * Read value is decompressed on first access of value(),
+ * so records which payload is not shown cost only copy of bytes.
+ * Lazy decompression is not thread safe,
+ * object must not be accessed from several threads at once
+ */
+template <typename T, int threshold = CompressedDetail::defaultThreshold>
+class Compressed
+{
+    static_assert(std::is_same<T, QString>{} || std::is_same<T, QByteArray>{},
+                  "only QString and QByteArray can be compressed");
+public:
+    Compressed() : _value(), _stored(), _decoded{ true } {}
+    Compressed(const T& value) : _value{ value }, _stored(), _decoded{ true } {}
+
+    /**
+     * @brief fromStored
+     * @param stored flag byte and raw or compressed bytes
+     */
+    static Compressed fromStored(const QByteArray& stored) {
+        Compressed result;
+        result._stored = stored;
+        result._decoded = false;
+        return result;
+    }
+
+    const T& value() const {
+        if (!_decoded) {
+            decode();
+        }
+        return _value;
+    }
+
+    operator const T&() const {
+        return value();
+    }
+
+    /**
+     * @brief stored
+     * @return flag byte and raw or compressed bytes
+     */
+    QByteArray stored() const {
+        if (!_decoded) {
+            return _stored;
+        }
+        const auto bytes = CompressedDetail::toBytes(_value);
+        if (bytes.size() >= threshold) {
+            const auto compressed = qCompress(bytes, CompressedDetail::compressionLevel);
+            // Incompressible data is kept raw
+            if (compressed.size() < bytes.size()) {
+                return char(CompressedDetail::Zlib) + compressed;
+            }
+        }
+        return char(CompressedDetail::Raw) + bytes;
+    }
+
+    bool operator==(const Compressed& other) const {
+        return value() == other.value();
+    }
+    bool operator!=(const Compressed& other) const {
+        return !operator==(other);
+    }
+    bool operator<(const Compressed& other) const {
+        return value() < other.value();
+    }
+
+private:
+    void decode() const {
+        _decoded = true;
+        if (_stored.isEmpty()) {
+            _value = T();
+            return;
+        }
+        const auto data = _stored.constData() + 1;
+        const auto size = _stored.size() - 1;
+        if (_stored.at(0) == char(CompressedDetail::Zlib)) {
+            const auto bytes = qUncompress(reinterpret_cast<const uchar*>(data), size);
+            _value = CompressedDetail::fromBytes<T>(bytes.constData(), bytes.size());
+        }
+        else {
+            _value = CompressedDetail::fromBytes<T>(data, size);
+        }
+        _stored = QByteArray();
+    }
+
+private:
+    mutable T _value;
+    mutable QByteArray _stored;
+    mutable bool _decoded;
+
+};
+
+template <typename T, int threshold>
+struct ColumnTraits<Compressed<T, threshold>> {
+    using Type = Compressed<T, threshold>;
+
+    static QString typeName() {
+        return "Compressed" + ColumnTraits<T>::typeName();
+    }
+    static QString sqlTypeName() {
+        return "BLOB";
+    }
+    static QVariant toStored(const Type& value) {
+        return QVariant(value.stored());
+    }
+    static Type fromStored(const QVariant& value) {
+        return Type::fromStored(value.toByteArray());
+    }
+    static Type fromBlob(const char* data, int size) {
+        return Type::fromStored(QByteArray(data, size));
+    }
+    /*
+     * Compression is deterministic, so equal values have equal bytes
+     */
+    static QString filterLiteral(const Type& value) {
+        return ColumnTraitsDetail::blobLiteral(value.stored());
+    }
+    static QVariant toDisplay(const Type& value) {
+        return QVariant(value.value());
+    }
+};
+
+#endif // COMPRESSED_H
@@ -1,8 +1,12 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <QObject>
 #include <QSqlDatabase>
@@ -10,8 +14,14 @@
 #include <QSqlRecord>
 #include <QSqlError>
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
 #include <QThread>
 #include <QMutex>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QRegularExpression>
 #include <QVector>
 
 #include "QtTupleConversions/structconversions.h"
@@ -19,8 +29,12 @@
 #include "QtTupleConversions/typelist.h"
 
 #include "database_detail.h"
+#include "databaseoptions.h"
+#include "partitionpolicy.h"
 #include "filter.h"
+#include "private/connectioncache.h"
 #include "private/databaserecord.h"
+#include "private/stringdictionary.h"
 
 #include <QtDebugPrint/debugoutput_disabled.h>
 
@@ -38,11 +52,18 @@ public:
     /**
      * @brief Database
      * @param databasePath Path to database file
-     * @param maxDatabaseSize Maximum size of database file in kilobytes
+     * @param maxDatabaseSize Maximum size of database file in kilobytes.
+     * Database itself does not enforce it, AsyncDatabase removes
+     * oldest records if DatabaseOptions::enforceMaxDatabaseSize is set
+     * @param options SQLite settings applied to each connection
+     * @param partitionPolicy if enabled, databasePath holds catalog
+     * and records are stored in partition files near it
      */
     explicit Database(
             const QString& databasePath,
-            int maxDatabaseSize = 2097152 // 2 Mb
+            int maxDatabaseSize = DatabaseDetail::defaultMaxDatabaseSize,
+            const DatabaseOptions& options = DatabaseOptions(),
+            const PartitionPolicy& partitionPolicy = PartitionPolicy()
             );
     ~Database();
 
@@ -87,9 +108,25 @@ public:
     std::enable_if_t<DatabaseDetail::OneLengthV<L>, bool>
     addRecord(const typename L::Head& r);// { return addRecord<0u>(r); }
 
-    // TODO add transactions when writes several records
-    // bool beginTransaction();
-    // bool commitTransaction();
+    /**
+     * @brief beginTransaction
+     * Starts transaction on connection of current thread,
+     * use it when writes several records
+     * @return if transaction started
+     */
+    bool beginTransaction();
+
+    /**
+     * @brief commitTransaction
+     * @return if transaction commited
+     */
+    bool commitTransaction();
+
+    /**
+     * @brief rollbackTransaction
+     * @return if transaction rolled back
+     */
+    bool rollbackTransaction();
 
     /**
      * @brief numberOfRecords
@@ -191,6 +228,73 @@ public:
     >
     read(unsigned offset, unsigned count, FilterType filter = FilterType());// { return read<0u>(offset, count); }
 
+    /**
+     * @brief readEach
+     * Calls f(record) for each record passing filter
+     * without collecting records into vector
+     * @param f callable taking const DatabaseRecord<Type>&,
+     * reading stops if it returns false
+     * @return false if read failed
+     */
+    template <
+            size_t tableIndex,
+            typename F,
+            typename FilterType = Filter<
+                typename Conversions::TypeAtT<
+                    Conversions::TypeList<T...>, tableIndex
+                    >,
+                FilterDetail::Blank>
+            >
+    bool readEach(F f, FilterType filter = FilterType());
+
+    /**
+     * @brief readColumns
+     * Reads columns Cols of records passing filter, ordered
+     * by row id, into one vector per column, without building records.
+     * Values are decoded without QVariant only with system SQLite.
+     * E.g. readColumns<0, 1, 3>(0, 0) returns tuple of vectors
+     * of members 1 and 3 of all records of table 0
+     * @param count count of records to read, 0 for all
+     */
+    template <
+            size_t tableIndex,
+            size_t... Cols,
+            typename FilterType = Filter<
+                typename Conversions::TypeAtT<
+                    Conversions::TypeList<T...>, tableIndex
+                    >,
+                FilterDetail::Blank>
+            >
+    typename DatabaseDetail::ColumnsReader<
+        typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>,
+        Cols...
+    >::Columns
+    readColumns(unsigned offset, unsigned count, FilterType filter = FilterType());
+
+    /**
+     * @brief visitColumns
+     * Calls f(values...) with columns Cols of each record
+     * passing filter, ordered by row id, reading stops if f returns false.
+     * With system SQLite QString and QByteArray values borrow
+     * memory of SQLite statement, they are valid only during call
+     * and must be copied to be kept. Default build does not borrow,
+     * every value is copied from QVariant as in readColumns
+     * @return false if read failed
+     */
+    template <
+            size_t tableIndex,
+            size_t... Cols,
+            typename F,
+            typename FilterType = Filter<
+                typename Conversions::TypeAtT<
+                    Conversions::TypeList<T...>, tableIndex
+                    >,
+                FilterDetail::Blank>
+            >
+    bool visitColumns(
+            unsigned offset, unsigned count,
+            F f, FilterType filter = FilterType());
+
 
 
 
@@ -273,7 +377,147 @@ public:
         bool>
     clearTable();
 
+    /**
+     * @brief maxDatabaseSize
+     * @return maximum size of database file in kilobytes,
+     * see DatabaseOptions::enforceMaxDatabaseSize
+     */
+    int maxDatabaseSize() const;
+
+    /**
+     * @brief usedSize
+     * Free pages left by removed records are reused
+     * by next writes, so they are not counted
+     * @return size of used database pages in kilobytes, -1 if fails
+     */
+    qint64 usedSize() const;
+
+    /**
+     * @brief removeOldestRecords
+     * Removes records with lowest row ids of all tables, count is
+     * shared between tables in proportion to their ranges of row ids,
+     * so table with few records (e.g. activations) loses none of them
+     * while other tables are large. Partitioned database removes
+     * oldest partition file instead.
+     * Database is not vacuumed, freed pages are reused by next writes
+     * @param count maximum count of records to remove
+     * @return count of removed records, -1 if fails
+     */
+    int removeOldestRecords(int count);
+
+    /**
+     * @brief removeRecords
+     * Removes oldest records passing filter.
+     * Blank filter is rejected, so table is not wiped by mistake,
+     * see clearTable()
+     * @param count maximum count of records to remove, 0 for all
+     * @return count of removed records, -1 if fails or filter is blank
+     */
+    template <
+            size_t tableIndex,
+            typename FilterType = Filter<
+                typename Conversions::TypeAtT<
+                    Conversions::TypeList<T...>, tableIndex
+                    >,
+                FilterDetail::Blank>>
+    std::enable_if_t<
+        Conversions::ValidIndexV<Conversions::TypeList<T...>, tableIndex>,
+        int>
+    removeRecords(FilterType filter = FilterType(), uint count = 0u);
+
+    /**
+     * @brief createIndex
+     * Creates index on column of table if it does not exist,
+     * it speeds up filters by this column
+     * @return if index exists
+     */
+    template <size_t tableIndex, size_t columnIndex>
+    std::enable_if_t<
+        Conversions::ValidIndexV<Conversions::TypeList<T...>, tableIndex>,
+        bool>
+    createIndex();
+
+    /**
+     * @brief pagesCount
+     * @return count of pages in database file, -1 if fails
+     */
+    qint64 pagesCount() const;
+
+    /**
+     * @brief freePagesCount
+     * @return count of unused pages in database file, -1 if fails
+     */
+    qint64 freePagesCount() const;
+
+    /**
+     * @brief incrementalVacuum
+     * Returns free pages to file system.
+     * Works only if database has incremental auto vacuum mode
+     * @param pages maximum count of pages to return
+     * @return if vacuum was success
+     */
+    bool incrementalVacuum(int pages);
+
+    /**
+     * @brief migrateAutoVacuum
+     * Sets auto vacuum mode of options to existing database file.
+     * Runs full VACUUM once if file has other mode,
+     * so it may take long time for large file
+     * @return true if database has auto vacuum mode of options
+     */
+    bool migrateAutoVacuum();
+
+    /**
+     * @brief notifyActivation
+     * Counts activation in current partition and starts
+     * next partition if PartitionPolicy::maxActivations is reached.
+     * Next record written is the activation record: partition
+     * is not changed before it and partition holding it
+     * is not removed by retention.
+     * Does nothing if database is not partitioned
+     */
+    void notifyActivation();
+
+    /**
+     * @brief partitionsCount
+     * @return count of partition files, 0 if database is not partitioned
+     */
+    int partitionsCount() const;
+
+    /**
+     * @brief connection
+     * @return connection of current thread,
+     * connection to catalog if database is partitioned
+     */
+    QSqlDatabase connection() const;
+
+    /**
+     * @brief backupSources
+     * Connections of current thread that must be copied
+     * to make backup of database at destinationPath.
+     * Partitioned database is copied as catalog and partition files,
+     * copies of partitions are named after destinationPath
+     * @return pairs of connection and path of its copy
+     */
+    QVector<QPair<QSqlDatabase, QString>> backupSources(
+            const QString& destinationPath) const;
+
 private:
+    /**
+     * @brief openTables
+     * Creates tables of new database or checks existing ones.
+     * Full check runs only if schema hash stored in
+     * PRAGMA user_version differs from schemaHash()
+     * @return true if tables correspond to structs
+     */
+    bool openTables();
+
+    /**
+     * @brief writeSchemaHash
+     * @return false if user_version can not be written
+     */
+    bool writeSchemaHash() const;
+
     /**
      * @brief createTables
      * @return true if database successfully created
@@ -283,6 +527,13 @@ private:
     template <size_t... Is>
     bool createTablesImpl(std::index_sequence<Is...>);
 
+    /**
+     * @brief createDictionaryTable
+     * Creates dictionary table if structs have Interned members
+     * @return false if table can not be created
+     */
+    bool createDictionaryTable() const;
+
     /**
      * @brief createTables
      * @return true if database successfully created
@@ -334,17 +585,104 @@ private:
     template <size_t... Is>
     bool clearDatabaseImpl(std::index_sequence<Is...>);
 
+    template <size_t... Is>
+    int removeOldestRecordsImpl(int count, std::index_sequence<Is...>);
+
+    /**
+     * @brief pragmaValue
+     * @return integer value of pragma, -1 if fails
+     */
+    qint64 pragmaValue(const QString& pragma) const;
+
+    template <size_t... Is>
+    qint64 recordsCountImpl(std::index_sequence<Is...>) const;
+
+    bool isPartitioned() const { return _partitionPolicy.isEnabled(); }
+
+    /**
+     * @brief openCatalog
+     * Creates or reads catalog and opens its partitions
+     * @return true if all partitions are valid
+     */
+    bool openCatalog();
+
+    /**
+     * @brief addPartition
+     * Starts new partition and removes oldest ones
+     * above PartitionPolicy::maxPartitions
+     */
+    bool addPartition();
+
+    /**
+     * @brief removablePartitionIndex
+     * Current partition and partition of live activation are kept
+     * @return index of oldest partition which can be removed, -1 if none
+     */
+    int removablePartitionIndex() const;
+    /**
+     * @brief removablePartitionIndexLocked
+     * Same as removablePartitionIndex(), caller holds _partitionsLock.
+     * QReadWriteLock can not be locked for read by thread
+     * holding it for write, even in recursive mode
+     */
+    int removablePartitionIndexLocked() const;
+
+    /**
+     * @brief removeOldestPartition
+     * Removes oldest removable partition with its file
+     * @return count of removed records, -1 if fails
+     */
+    qint64 removeOldestPartition();
+
+    /**
+     * @brief rollPartitionIfNeeded
+     * Starts new partition if period or size of current one is over.
+     * Called before writes outside of transaction
+     */
+    void rollPartitionIfNeeded();
+
+    Database<T...>* currentPartition() const;
+    Database<T...>* partition(qint64 sequence) const;
+    QString partitionPath(qint64 sequence) const;
+
+    /**
+     * @brief forEachColumnsRow
+     * Executes columns query and calls f(row) for each row,
+     * row is sqlite3_stmt* on direct path or QSqlQuery.
+     * Stops if f returns false
+     * @return false if query failed
+     */
+    template <typename Reader, typename F>
+    bool forEachColumnsRow(const QString& queryString, F f) const;
+
     QString currentThreadConnectionName() const;
 
+    /**
+     * @brief configureConnection
+     * Opens new connection and applies options to it
+     */
+    void configureConnection(QSqlDatabase& db) const;
+
     /*
      * For test reasons
      */
     friend class TestDatabase;
 
 private:
+    /**
+     * @brief _instanceId
+     * Key of cached connections, see ConnectionCache
+     */
+    const quint64 _instanceId;
     mutable QVector<QString> _connections;
     mutable QMutex _connectionsMutex;
 
+    /**
+     * @brief _dictionary
+     * Strings of Interned columns, used only by structs with them
+     */
+    mutable StringDictionary _dictionary;
+
     /**
      * @brief _path
      * Path to database file
@@ -357,6 +695,41 @@ private:
      */
     const int _maxDatabaseSize;
 
+    /**
+     * @brief _options
+     * Settings applied to each connection
+     */
+    const DatabaseOptions _options;
+
+    struct Partition {
+        qint64 sequence;
+        QDateTime created;
+        int activations;
+        std::unique_ptr<Database<T...>> database;
+    };
+
+    const PartitionPolicy _partitionPolicy;
+    /*
+     * Partitions ordered from oldest, list is changed under write lock.
+     * New partitions are added only by writer thread
+     */
+    std::vector<Partition> _partitions;
+    mutable QReadWriteLock _partitionsLock;
+    /*
+     * Applied to each new partition, e.g. to create indices
+     */
+    std::vector<std::function<void(Database<T...>*)>> _partitionSetup;
+    /*
+     * Accessed only from writer thread
+     */
+    bool _inTransaction;
+    int _writesSinceSizeCheck;
+    /*
+     * Sequence of partition with live activation record, 0 if none
+     */
+    qint64 _activationSequence;
+    bool _activationPending;
+
     /**
      * @brief _valid
      * true if database valid
@@ -376,23 +749,41 @@ class Database<> {};
 namespace DatabasePrivate {
 inline const QString DB_TYPE = "QSQLITE";
 inline const QString DB_NAME = "dbname";
+inline const QString CATALOG_TABLE = "partitions";
+/*
+ * Size of partition is checked once per this count of writes
+ */
+inline const int PARTITION_SIZE_CHECK_INTERVAL = 256;
 }
 
 template <typename... T>
 Database<T...>::Database(
         const QString& databasePath,
-        int maxDatabaseSize
+        int maxDatabaseSize,
+        const DatabaseOptions& options,
+        const PartitionPolicy& partitionPolicy
         )
-    : _connections{}
+    : _instanceId{ ConnectionCache::nextInstanceId() }
+    , _connections{}
     , _connectionsMutex()
+    , _dictionary()
     , _path{databasePath}
     , _maxDatabaseSize{maxDatabaseSize}
+    , _options{options}
+    , _partitionPolicy{partitionPolicy}
+    , _partitions()
+    , _partitionsLock(QReadWriteLock::Recursive)
+    , _partitionSetup()
+    , _inTransaction{false}
+    , _writesSinceSizeCheck{0}
+    , _activationSequence{0}
+    , _activationPending{false}
     , _valid( (
           //QSqlDatabase::addDatabase(DatabasePrivate::DB_TYPE, currentThreadConnectionName()).setDatabaseName(databasePath),
           //QSqlDatabase::database().setDatabaseName(databasePath),
-          QSqlDatabase::database(currentThreadConnectionName()).tables().isEmpty()
-            ? createTables()
-            : checkTypes()
+          isPartitioned()
+            ? openCatalog()
+            : openTables()
           ) )
 {
 
@@ -401,6 +792,9 @@ Database<T...>::Database(
 
 template <typename... T>
 Database<T...>::~Database() {
+    _partitions.clear();
+    // Cached copies would keep connections in use
+    ConnectionCache::remove(_instanceId);
     _connectionsMutex.lock();
     foreach (auto connection, _connections) {
         QSqlDatabase::removeDatabase(connection);
@@ -432,9 +826,19 @@ Database<T...>::addRecord(const Type& r) {
     if (!isValid()) {
         return false;
     }
+    if (isPartitioned()) {
+        if (!_inTransaction) {
+            rollPartitionIfNeeded();
+        }
+        QReadLocker l(&_partitionsLock);
+        const bool success = currentPartition()->template addRecord<tableIndex>(r);
+        if (success) {
+            _activationPending = false;
+        }
+        return success;
+    }
 
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    auto db = connection();
     QSqlQuery addQuery(db);
 
     addQuery.prepare(DatabaseDetail::addRecordQuery<Type, tableIndex>());
@@ -444,7 +848,10 @@ Database<T...>::addRecord(const Type& r) {
 //    DatabaseDetail::QueryFiller<
 //            decltype(t), std::make_index_sequence<size>
 //            >::populateSqlQuery(addQuery, t);
-    DatabaseDetail::populateSqlQuery(addQuery, r);
+    const DatabaseDetail::InternContext context{ &_dictionary, db };
+    DatabaseDetail::populateSqlQuery(
+                addQuery, r,
+                DatabaseDetail::HasInternedV<Type> ? &context : nullptr);
 
     return addQuery.exec();
 }
@@ -456,6 +863,53 @@ Database<T...>::addRecord(const typename L::Head& r) {
     return addRecord<0u>(r);
 }
 
+template <typename... T>
+bool Database<T...>::beginTransaction() {
+    if (!isValid()) {
+        return false;
+    }
+    if (isPartitioned()) {
+        // Partition is not changed inside transaction
+        rollPartitionIfNeeded();
+        QReadLocker l(&_partitionsLock);
+        _inTransaction = currentPartition()->beginTransaction();
+        return _inTransaction;
+    }
+    auto db = connection();
+    return db.transaction();
+}
+
+template <typename... T>
+bool Database<T...>::commitTransaction() {
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        _inTransaction = false;
+        return currentPartition()->commitTransaction();
+    }
+    auto db = connection();
+    const bool success = db.commit();
+    if (!success) {
+        qDebug() << "commit failed:" << db.lastError().text();
+        db.rollback();
+        // Strings interned in transaction are not stored
+        _dictionary.clear();
+    }
+    return success;
+}
+
+template <typename... T>
+bool Database<T...>::rollbackTransaction() {
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        _inTransaction = false;
+        return currentPartition()->rollbackTransaction();
+    }
+    auto db = connection();
+    // Strings interned in transaction are not stored
+    _dictionary.clear();
+    return db.rollback();
+}
+
 template <typename... T>
 template <typename Type, typename FilterType>
 std::enable_if_t<
@@ -478,8 +932,19 @@ Database<T...>::numberOfRecords(FilterType filter) const {
         qDebug() << "Database not valid";
         return -1;
     }
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        uint result = 0u;
+        for (const auto& p : _partitions) {
+            const auto count = p.database->template numberOfRecords<tableIndex>(filter);
+            if (count == uint(-1)) {
+                return -1;
+            }
+            result += count;
+        }
+        return result;
+    }
+    auto db = connection();
     QSqlQuery numberQuery(db);
     //QString queryString = DatabaseDetail::maxRowIdQuery();
     QString queryString = DatabaseDetail::countQuery<tableIndex>();
@@ -488,7 +953,7 @@ Database<T...>::numberOfRecords(FilterType filter) const {
     if (numberQuery.exec()) {
         int idMaxId = numberQuery.record().indexOf("maxId");
         numberQuery.first();
-        int numberOfLines = numberQuery.value(idMaxId).toInt();
+        const auto numberOfLines = numberQuery.value(idMaxId).toLongLong();
         return numberOfLines;
     }
     return -1; // TODO change
@@ -528,8 +993,17 @@ Database<T...>::maxRowId() const {
         qDebug() << "Database not valid";
         return -1;
     }
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        for (auto it = _partitions.rbegin(); it != _partitions.rend(); ++it) {
+            const auto rowId = it->database->template maxRowId<tableIndex>();
+            if (rowId > 0) {
+                return DatabaseDetail::partitionRowId(it->sequence, rowId);
+            }
+        }
+        return 0;
+    }
+    auto db = connection();
     QSqlQuery numberQuery(db);
     QString queryString = DatabaseDetail::maxRowIdQuery<tableIndex>();
     //QString queryString = DatabaseDetail::countQuery<tableIndex>();
@@ -580,6 +1054,35 @@ Database<T...>::read(uint offset, uint count, FilterType filter) {
         qDebug() << "Database not valid";
         return result;
     }
+    if (isPartitioned()) {
+        // Partitions are read from oldest, as one table
+        QReadLocker l(&_partitionsLock);
+        for (const auto& p : _partitions) {
+            if (count != 0u && uint(result.size()) >= count) {
+                break;
+            }
+            const auto partitionCount =
+                    p.database->template numberOfRecords<tableIndex>(filter);
+            if (partitionCount == uint(-1)) {
+                continue;
+            }
+            if (offset >= partitionCount) {
+                offset -= partitionCount;
+                continue;
+            }
+            const auto toRead = count == 0u
+                    ? partitionCount - offset
+                    : std::min(count - uint(result.size()), partitionCount - offset);
+            auto records = p.database->template read<tableIndex>(
+                        offset, toRead, filter);
+            offset = 0u;
+            for (auto& r : records) {
+                r.rowId = DatabaseDetail::partitionRowId(p.sequence, r.rowId);
+                result.append(std::move(r));
+            }
+        }
+        return result;
+    }
 
     auto recordsCount = numberOfRecords<tableIndex>(filter);
     if (recordsCount < 0) {
@@ -589,9 +1092,10 @@ Database<T...>::read(uint offset, uint count, FilterType filter) {
     }
     result.reserve(std::min(count, uint(recordsCount)));
 
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    auto db = connection();
     QSqlQuery readQuery(db);
+    // Rows are not cached by query for scrolling back
+    readQuery.setForwardOnly(true);
     auto queryString = DatabaseDetail::readQuery<tableIndex>(
                 offset, count, filter.query());
 //    qDebug() << AS_KV(queryString) << _path;
@@ -603,11 +1107,12 @@ Database<T...>::read(uint offset, uint count, FilterType filter) {
         return result;
     }
 
-    readQuery.first();
-    readQuery.previous();
-
+    const DatabaseDetail::InternContext context{ &_dictionary, db };
     while (readQuery.next())  {
-        auto t = DatabaseDetail::extractRecord<Type>(readQuery.record());
+        auto t = DatabaseDetail::extractRecord<Type>(readQuery);
+        if constexpr (DatabaseDetail::HasInternedV<Type>) {
+            DatabaseDetail::resolveInternedTuple(t, &context);
+        }
         Type s = StructConversions::makeFromTuple<Type>(t);
         result.append(s);
     }
@@ -626,6 +1131,177 @@ Database<T...>::read(unsigned offset, unsigned count, FilterType filter) {
     return read<0u>(offset, count, filter);
 }
 
+template <typename... T>
+template <size_t tableIndex, size_t... Cols, typename FilterType>
+typename DatabaseDetail::ColumnsReader<
+    typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>,
+    Cols...
+>::Columns
+Database<T...>::readColumns(unsigned offset, unsigned count, FilterType filter) {
+    using Type = typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>;
+    using Reader = DatabaseDetail::ColumnsReader<Type, Cols...>;
+    static_assert(sizeof...(Cols) > 0, "no columns to read");
+    typename Reader::Columns result;
+    if (!isValid()) {
+        qDebug() << "Database not valid";
+        return result;
+    }
+    if (isPartitioned()) {
+        // Partitions are read from oldest, as one table
+        QReadLocker l(&_partitionsLock);
+        uint readCount = 0u;
+        for (const auto& p : _partitions) {
+            if (count != 0u && readCount >= count) {
+                break;
+            }
+            const auto partitionCount =
+                    p.database->template numberOfRecords<tableIndex>(filter);
+            if (partitionCount == uint(-1)) {
+                continue;
+            }
+            if (offset >= partitionCount) {
+                offset -= partitionCount;
+                continue;
+            }
+            const auto toRead = count == 0u
+                    ? partitionCount - offset
+                    : std::min(count - readCount, partitionCount - offset);
+            auto part = p.database->template readColumns<tableIndex, Cols...>(
+                        offset, toRead, filter);
+            offset = 0u;
+            readCount += uint(std::get<0>(part).size());
+            Reader::appendColumns(result, std::move(part));
+        }
+        return result;
+    }
+
+    const auto recordsCount = numberOfRecords<tableIndex>(filter);
+    if (recordsCount != uint(-1) && recordsCount > offset) {
+        const auto available = recordsCount - offset;
+        Reader::reserve(result, count == 0u ? available : std::min(count, available));
+    }
+    forEachColumnsRow<Reader>(
+                DatabaseDetail::readColumnsQuery<Type, tableIndex, Cols...>(
+                    offset, count, filter.query()),
+                [&result](const auto& row) {
+        Reader::appendRow(result, row);
+        return true;
+    });
+    const DatabaseDetail::InternContext context{ &_dictionary, connection() };
+    Reader::resolveInterned(result, &context);
+    return result;
+}
+
+template <typename... T>
+template <size_t tableIndex, size_t... Cols, typename F, typename FilterType>
+bool Database<T...>::visitColumns(
+        unsigned offset, unsigned count, F f, FilterType filter)
+{
+    using Type = typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>;
+    using Reader = DatabaseDetail::ColumnsReader<Type, Cols...>;
+    static_assert(sizeof...(Cols) > 0, "no columns to read");
+    if (!isValid()) {
+        qDebug() << "Database not valid";
+        return false;
+    }
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        uint visited = 0u;
+        bool stopped = false;
+        for (const auto& p : _partitions) {
+            if (stopped || (count != 0u && visited >= count)) {
+                break;
+            }
+            const auto partitionCount =
+                    p.database->template numberOfRecords<tableIndex>(filter);
+            if (partitionCount == uint(-1)) {
+                continue;
+            }
+            if (offset >= partitionCount) {
+                offset -= partitionCount;
+                continue;
+            }
+            const auto toVisit = count == 0u
+                    ? partitionCount - offset
+                    : std::min(count - visited, partitionCount - offset);
+            const bool ok = p.database->template visitColumns<tableIndex, Cols...>(
+                        offset, toVisit,
+                        [&f, &stopped](const auto&... values) {
+                stopped = !f(values...);
+                return !stopped;
+            }, filter);
+            if (!ok) {
+                return false;
+            }
+            offset = 0u;
+            visited += toVisit;
+        }
+        return true;
+    }
+
+    const DatabaseDetail::InternContext context{ &_dictionary, connection() };
+    return forEachColumnsRow<Reader>(
+                DatabaseDetail::readColumnsQuery<Type, tableIndex, Cols...>(
+                    offset, count, filter.query()),
+                [&f, &context](const auto& row) {
+        return Reader::visitRow(f, row, &context);
+    });
+}
+
+template <typename... T>
+template <size_t tableIndex, typename F, typename FilterType>
+bool Database<T...>::readEach(F f, FilterType filter) {
+    using Type = DatabaseRecord<
+        Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>
+        >;
+    if (!isValid()) {
+        qDebug() << "Database not valid";
+        return false;
+    }
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        bool stopped = false;
+        for (const auto& p : _partitions) {
+            const auto sequence = p.sequence;
+            const bool ok = p.database->template readEach<tableIndex>(
+                        [&f, &stopped, sequence](const Type& r) {
+                Type record = r;
+                record.rowId = DatabaseDetail::partitionRowId(sequence, r.rowId);
+                stopped = !f(static_cast<const Type&>(record));
+                return !stopped;
+            }, filter);
+            if (!ok) {
+                return false;
+            }
+            if (stopped) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    auto db = connection();
+    QSqlQuery readQuery(db);
+    readQuery.setForwardOnly(true);
+    readQuery.prepare(DatabaseDetail::readQuery<tableIndex>(0u, 0u, filter.query()));
+    if (!readQuery.exec()) {
+        qDebug() << "read query exec error" << readQuery.lastError().text();
+        return false;
+    }
+    const DatabaseDetail::InternContext context{ &_dictionary, db };
+    while (readQuery.next()) {
+        auto t = DatabaseDetail::extractRecord<Type>(readQuery);
+        if constexpr (DatabaseDetail::HasInternedV<Type>) {
+            DatabaseDetail::resolveInternedTuple(t, &context);
+        }
+        const Type record = StructConversions::makeFromTuple<Type>(t);
+        if (!f(record)) {
+            break;
+        }
+    }
+    return true;
+}
+
 
 
 
@@ -656,14 +1332,26 @@ Database<T...>::updateRecord(const DatabaseRecord<Type>& r) {
     if (!isValid()) {
         return false;
     }
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        auto p = partition(DatabaseDetail::partitionSequence(r.rowId));
+        if (p == nullptr) {
+            return false;
+        }
+        DatabaseRecord<Type> local(r);
+        local.rowId = DatabaseDetail::localRowId(r.rowId);
+        return p->template updateRecord<tableIndex>(local);
+    }
 
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    auto db = connection();
     QSqlQuery updateQuery(db);
     const Type& t = r;
     auto queryString = DatabaseDetail::updateRecordQuery<Type, tableIndex>(r.rowId);
     updateQuery.prepare(queryString);
-    DatabaseDetail::populateSqlQuery(updateQuery, t);
+    const DatabaseDetail::InternContext context{ &_dictionary, db };
+    DatabaseDetail::populateSqlQuery(
+                updateQuery, t,
+                DatabaseDetail::HasInternedV<Type> ? &context : nullptr);
     const auto success = updateQuery.exec();
 
     //qDebug() << "update successful:" << success << queryString;
@@ -713,18 +1401,30 @@ Database<T...>::removeHalfRecords() {
     if (!isValid()) {
         return false;
     }
+    if (isPartitioned()) {
+        // Older half of partitions is removed with files
+        if (removablePartitionIndex() >= 0) {
+            bool success = true;
+            for (auto i = partitionsCount() / 2;
+                 i > 0 && removablePartitionIndex() >= 0; --i) {
+                success &= removeOldestPartition() >= 0;
+            }
+            return success;
+        }
+        QReadLocker l(&_partitionsLock);
+        return currentPartition()->template removeHalfRecords<tableIndex>();
+    }
 
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    auto db = connection();
     QSqlQuery deleteQuery(db);
 
     QString query = DatabaseDetail::removeHalfRecordsQuery<tableIndex>();
 
     deleteQuery.prepare(query);
 
-    return (deleteQuery.exec()
-            ? vacuumDatabase()
-            : false);
+    // Freed pages are reused by next writes
+    // or returned by incremental vacuum
+    return deleteQuery.exec();
 }
 
 template <typename... T>
@@ -736,10 +1436,16 @@ Database<T...>::removeHalfRecords() {
 
 template <typename... T>
 bool Database<T...>::clearDatabase() {
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        bool success = true;
+        for (const auto& p : _partitions) {
+            success &= p.database->clearDatabase();
+        }
+        return success;
+    }
     const auto count = sizeof...(T);
-    bool result = clearDatabaseImpl(std::make_index_sequence<count>{});
-    result &= vacuumDatabase();
-    return result;
+    return clearDatabaseImpl(std::make_index_sequence<count>{});
 }
 
 template<typename... T>
@@ -751,9 +1457,16 @@ Database<T...>::clearTable() {
     if (!isValid()) {
         return false;
     }
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        bool success = true;
+        for (const auto& p : _partitions) {
+            success &= p.database->template clearTable<tableIndex>();
+        }
+        return success;
+    }
 
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    auto db = connection();
     QSqlQuery clearQuery(db);
 
     QString queryString = "DELETE FROM ";
@@ -763,15 +1476,320 @@ Database<T...>::clearTable() {
     return clearQuery.exec();
 }
 
+template <typename... T>
+int Database<T...>::maxDatabaseSize() const {
+    return _maxDatabaseSize;
+}
+
+template <typename... T>
+qint64 Database<T...>::usedSize() const {
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        qint64 result = 0;
+        for (const auto& p : _partitions) {
+            const auto size = p.database->usedSize();
+            if (size < 0) {
+                return -1;
+            }
+            result += size;
+        }
+        return result;
+    }
+    auto db = connection();
+    QSqlQuery sizeQuery(db);
+    if (!sizeQuery.exec(DatabaseDetail::usedSizeQuery())
+            || !sizeQuery.next()) {
+        qDebug() << "can not get size" << sizeQuery.lastError().text();
+        return -1;
+    }
+    return sizeQuery.value(0).toLongLong() / 1024;
+}
+
+template <typename... T>
+int Database<T...>::removeOldestRecords(int count) {
+    if (!isValid()) {
+        return -1;
+    }
+    if (isPartitioned()) {
+        // Removing of oldest partition file is cheaper than delete
+        if (removablePartitionIndex() >= 0) {
+            return int(removeOldestPartition());
+        }
+        QReadLocker l(&_partitionsLock);
+        return currentPartition()->removeOldestRecords(count);
+    }
+    const auto tablesCount = sizeof...(T);
+    return removeOldestRecordsImpl(
+                count, std::make_index_sequence<tablesCount>{});
+}
+
+template <typename... T>
+template <size_t tableIndex, typename FilterType>
+std::enable_if_t<
+    Conversions::ValidIndexV<Conversions::TypeList<T...>, tableIndex>,
+    int>
+Database<T...>::removeRecords(FilterType filter, uint count) {
+    if (!isValid()) {
+        return -1;
+    }
+    if (filter.query().isEmpty()) {
+        qDebug() << "can not remove records without filter";
+        return -1;
+    }
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        int result = 0;
+        for (const auto& p : _partitions) {
+            if (count != 0u && uint(result) >= count) {
+                break;
+            }
+            const auto removed = p.database->template removeRecords<tableIndex>(
+                        filter, count == 0u ? 0u : count - uint(result));
+            if (removed < 0) {
+                return -1;
+            }
+            result += removed;
+        }
+        return result;
+    }
+    auto db = connection();
+    QSqlQuery removeQuery(db);
+    removeQuery.prepare(DatabaseDetail::removeRecordsQuery<tableIndex>(
+                            filter.query(), count));
+    if (!removeQuery.exec()) {
+        qDebug() << "can not remove records"
+            << removeQuery.lastError().text();
+        return -1;
+    }
+    return removeQuery.numRowsAffected();
+}
+
+template <typename... T>
+template <size_t tableIndex, size_t columnIndex>
+std::enable_if_t<
+    Conversions::ValidIndexV<Conversions::TypeList<T...>, tableIndex>,
+    bool>
+Database<T...>::createIndex() {
+    using Type = Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>;
+    if (!isValid()) {
+        return false;
+    }
+    if (isPartitioned()) {
+        QWriteLocker l(&_partitionsLock);
+        _partitionSetup.push_back([](Database<T...>* database) {
+            database->template createIndex<tableIndex, columnIndex>();
+        });
+        bool success = true;
+        for (const auto& p : _partitions) {
+            success &= p.database->template createIndex<tableIndex, columnIndex>();
+        }
+        return success;
+    }
+    auto db = connection();
+    QSqlQuery indexQuery(db);
+    indexQuery.prepare(DatabaseDetail::createIndexQuery<
+                       Type, tableIndex, columnIndex>());
+    const bool success = indexQuery.exec();
+    if (!success) {
+        qDebug() << "can not create index"
+            << indexQuery.lastError().text();
+    }
+    return success;
+}
+
+template <typename... T>
+qint64 Database<T...>::pagesCount() const {
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        qint64 result = 0;
+        for (const auto& p : _partitions) {
+            result += p.database->pagesCount();
+        }
+        return result;
+    }
+    return pragmaValue("page_count");
+}
+
+template <typename... T>
+qint64 Database<T...>::freePagesCount() const {
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        qint64 result = 0;
+        for (const auto& p : _partitions) {
+            result += p.database->freePagesCount();
+        }
+        return result;
+    }
+    return pragmaValue("freelist_count");
+}
+
+template <typename... T>
+bool Database<T...>::incrementalVacuum(int pages) {
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        bool success = true;
+        for (const auto& p : _partitions) {
+            if (p.database->freePagesCount() > 0) {
+                success &= p.database->incrementalVacuum(pages);
+            }
+        }
+        return success;
+    }
+    auto db = connection();
+    QSqlQuery vacuumQuery(db);
+    vacuumQuery.prepare(
+                QString("PRAGMA incremental_vacuum(")
+                + QString::number(pages) + ")");
+    // Each execution returns one page,
+    // transaction syncs file once for all of them
+    const bool transaction = beginTransaction();
+    bool success = true;
+    for (auto i = 0; i < pages && success; ++i) {
+        success = vacuumQuery.exec();
+    }
+    vacuumQuery.finish();
+    if (transaction) {
+        success &= commitTransaction();
+    }
+    if (!success) {
+        qDebug() << "incremental vacuum failed"
+            << vacuumQuery.lastError().text();
+    }
+    return success;
+}
+
+template <typename... T>
+bool Database<T...>::migrateAutoVacuum() {
+    if (_options.autoVacuum == DatabaseOptions::AutoVacuum::Default) {
+        return true;
+    }
+    if (isPartitioned()) {
+        QReadLocker l(&_partitionsLock);
+        bool success = true;
+        for (const auto& p : _partitions) {
+            success &= p.database->migrateAutoVacuum();
+        }
+        return success;
+    }
+    // PRAGMA auto_vacuum returns 0, 1 or 2 for none, full and incremental
+    const auto wanted = static_cast<qint64>(_options.autoVacuum)
+            - static_cast<qint64>(DatabaseOptions::AutoVacuum::None);
+    if (pragmaValue("auto_vacuum") == wanted) {
+        return true;
+    }
+
+    auto db = connection();
+    QSqlQuery autoVacuumQuery(db);
+    if (!autoVacuumQuery.exec(_options.autoVacuumPragma())
+            || !vacuumDatabase()) {
+        qDebug() << "can not change auto vacuum of" << _path;
+        return false;
+    }
+    return pragmaValue("auto_vacuum") == wanted;
+}
+
+template <typename... T>
+void Database<T...>::notifyActivation() {
+    if (!isPartitioned() || !isValid()) {
+        return;
+    }
+    bool full = false;
+    if (_partitionPolicy.maxActivations > 0) {
+        QReadLocker l(&_partitionsLock);
+        full = _partitions.back().activations >= _partitionPolicy.maxActivations;
+    }
+    if (full) {
+        addPartition();
+    }
+
+    QReadLocker l(&_partitionsLock);
+    auto& current = _partitions.back();
+    ++current.activations;
+    _activationSequence = current.sequence;
+    _activationPending = true;
+    auto db = connection();
+    QSqlQuery updateQuery(db);
+    updateQuery.prepare(
+                "UPDATE " + DatabasePrivate::CATALOG_TABLE
+                + " SET activations = ? WHERE sequence = ?");
+    updateQuery.addBindValue(current.activations);
+    updateQuery.addBindValue(current.sequence);
+    if (!updateQuery.exec()) {
+        qDebug() << "can not update catalog" << updateQuery.lastError().text();
+    }
+}
+
+template <typename... T>
+int Database<T...>::partitionsCount() const {
+    QReadLocker l(&_partitionsLock);
+    return int(_partitions.size());
+}
+
+template <typename... T>
+QSqlDatabase Database<T...>::connection() const {
+    auto db = ConnectionCache::find(_instanceId);
+    if (!db.isValid()) {
+        db = QSqlDatabase::database(currentThreadConnectionName());
+        ConnectionCache::insert(_instanceId, db);
+    }
+    return db;
+}
+
+template <typename... T>
+QVector<QPair<QSqlDatabase, QString>> Database<T...>::backupSources(
+        const QString& destinationPath) const
+{
+    QVector<QPair<QSqlDatabase, QString>> result;
+    result.append(qMakePair(connection(), destinationPath));
+    QReadLocker l(&_partitionsLock);
+    for (const auto& p : _partitions) {
+        result.append(qMakePair(
+                          p.database->connection(),
+                          DatabaseDetail::partitionFilePath(
+                              destinationPath, p.sequence)));
+    }
+    return result;
+}
+
 /* ******************************************************************
  * Private
  * ******************************************************************
  */
 
+template <typename... T>
+bool Database<T...>::openTables() {
+    // One pragma instead of catalog query for each table
+    if (pragmaValue("user_version") == DatabaseDetail::schemaHash<T...>()) {
+        return true;
+    }
+    const bool valid = connection().tables().isEmpty()
+            ? createTables()
+            : checkTypes();
+    if (valid) {
+        // Without hash next open checks tables again
+        writeSchemaHash();
+    }
+    return valid;
+}
+
+template <typename... T>
+bool Database<T...>::writeSchemaHash() const {
+    QSqlQuery versionQuery(connection());
+    if (!versionQuery.exec(
+                "PRAGMA user_version = "
+                + QString::number(DatabaseDetail::schemaHash<T...>()))) {
+        qDebug() << "can not write schema hash"
+            << versionQuery.lastError().text();
+        return false;
+    }
+    return true;
+}
+
 template <typename... T>
 bool Database<T...>::createTables() {
     auto const count = sizeof...(T);
-    return createTablesImpl(std::make_index_sequence<count>{});
+    return createTablesImpl(std::make_index_sequence<count>{})
+            && createDictionaryTable();
 }
 
 template <typename... T>
@@ -782,6 +1800,21 @@ bool Database<T...>::createTablesImpl(std::index_sequence<Is...>) {
     return success;
 }
 
+template <typename... T>
+bool Database<T...>::createDictionaryTable() const {
+    if constexpr (!(DatabaseDetail::HasInternedV<T> || ...)) {
+        return true;
+    }
+    auto db = connection();
+    QSqlQuery createQuery(db);
+    if (!createQuery.exec(StringDictionary::createTableQuery())) {
+        qDebug() << "can not create dictionary table"
+            << createQuery.lastError().text();
+        return false;
+    }
+    return true;
+}
+
 template <typename... T>
 template <size_t tableIndex>
 std::enable_if_t<
@@ -789,8 +1822,7 @@ std::enable_if_t<
     bool>
 Database<T...>::createTable() {
     using Type = Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>;
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    auto db = connection();
     //qDebug() << "valid:" << db.isValid() << db.isOpen();
 
     QSqlQuery createQuery(db);
@@ -818,12 +1850,14 @@ bool Database<T...>::checkTypes() const {
 
     qDebug() << "check types";
     {
-        auto connectionName = currentThreadConnectionName();
-        auto db = QSqlDatabase::database(connectionName);
-        if (db.tables().size() != count) {
+        auto db = connection();
+        // Dictionary and other internal tables are not counted
+        const QRegularExpression structTable("^table\\d+$");
+        const auto tablesCount = db.tables().filter(structTable).size();
+        if (tablesCount != int(count)) {
             qDebug() << db.databaseName()
                 << "wrong tables count. Wait for"
-                << count << "but exist" << db.tables().size();
+                << count << "but exist" << tablesCount;
             return false;
         }
     }
@@ -834,7 +1868,7 @@ bool Database<T...>::checkTypes() const {
 
     const bool checkCorrect = checkTypesImpl(std::make_index_sequence<count>{});
 //    qDebug() << AS_KV(checkCorrect);
-    return checkCorrect;
+    return checkCorrect && createDictionaryTable();
 }
 
 template <typename... T>
@@ -854,14 +1888,9 @@ std::enable_if_t<
 Database<T...>::checkType() const {
     using Type = Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>;
 
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
-
-    auto const tablesCount = Conversions::TypeList<T...>::length;
-    // BUG reverse table order
-    auto table = db.tables().at(tablesCount - tableIndex - 1u);
+    auto db = connection();
 
-    auto record = db.record(table);
+    auto record = db.record(DatabaseDetail::tableName<tableIndex>());
     const auto structSize = StructConversions::StructExtractor<Type>::size;//to_tuple_size<Type>::value;
     if (structSize != record.count()) {
         qDebug() << db.databaseName()
@@ -899,8 +1928,7 @@ Database<T...>::checkType() const {
 
 template <typename... T>
 bool Database<T...>::vacuumDatabase() {
-    auto connectionName = currentThreadConnectionName();
-    auto db = QSqlDatabase::database(connectionName);
+    auto db = connection();
     QSqlQuery vacuumQuery(db);
     vacuumQuery.prepare("VACUUM");
     return vacuumQuery.exec();
@@ -914,16 +1942,311 @@ bool Database<T...>::clearDatabaseImpl(std::index_sequence<Is...>) {
     return success;
 }
 
+template <typename... T>
+template <size_t... Is>
+int Database<T...>::removeOldestRecordsImpl(
+        int count, std::index_sequence<Is...>)
+{
+    const QStringList spanQueries{ DatabaseDetail::rowIdSpanQuery<Is>()... };
+    using RemoveQuery = QString (*)(int);
+    const RemoveQuery removeQueries[] = {
+        &DatabaseDetail::removeOldestRecordsQuery<Is>... };
+
+    auto db = connection();
+    QSqlQuery query(db);
+
+    // Span of row ids is got from rowid index, unlike count(*)
+    QVector<qint64> spans;
+    qint64 totalSpan = 0;
+    auto widest = -1;
+    for (auto i = 0; i < spanQueries.size(); ++i) {
+        if (!query.exec(spanQueries.at(i)) || !query.next()) {
+            return -1;
+        }
+        const auto span = query.value(0).toLongLong();
+        if (widest < 0 || span > spans.at(widest)) {
+            widest = i;
+        }
+        spans.append(span);
+        totalSpan += span;
+    }
+    if (totalSpan == 0) {
+        return 0;
+    }
+
+    int removed = 0;
+    for (auto i = 0; i < spans.size(); ++i) {
+        auto tableCount = int(qint64(count) * spans.at(i) / totalSpan);
+        // Widest table always makes progress
+        if (i == widest) {
+            tableCount = qMax(tableCount, 1);
+        }
+        if (tableCount == 0) {
+            continue;
+        }
+        if (!query.exec(removeQueries[i](tableCount))) {
+            qDebug() << "can not remove oldest records"
+                << query.lastError().text();
+            return -1;
+        }
+        removed += query.numRowsAffected();
+    }
+    return removed;
+}
+
+template <typename... T>
+template <size_t... Is>
+qint64 Database<T...>::recordsCountImpl(std::index_sequence<Is...>) const {
+    return (qint64(numberOfRecords<Is>()) + ...);
+}
+
+template <typename... T>
+bool Database<T...>::openCatalog() {
+    auto db = connection();
+    QSqlQuery catalogQuery(db);
+    if (!catalogQuery.exec(
+                "CREATE TABLE IF NOT EXISTS " + DatabasePrivate::CATALOG_TABLE
+                + "(sequence INTEGER PRIMARY KEY, created INTEGER,"
+                  " activations INTEGER)")) {
+        qDebug() << "can not create catalog" << catalogQuery.lastError().text();
+        return false;
+    }
+    if (!catalogQuery.exec(
+                "SELECT sequence, created, activations FROM "
+                + DatabasePrivate::CATALOG_TABLE + " ORDER BY sequence")) {
+        qDebug() << "can not read catalog" << catalogQuery.lastError().text();
+        return false;
+    }
+
+    bool success = true;
+    QWriteLocker l(&_partitionsLock);
+    while (catalogQuery.next()) {
+        const auto sequence = catalogQuery.value(0).toLongLong();
+        Partition p {
+            sequence,
+            QDateTime::fromMSecsSinceEpoch(catalogQuery.value(1).toLongLong()),
+            catalogQuery.value(2).toInt(),
+            std::make_unique<Database<T...>>(
+                partitionPath(sequence), _maxDatabaseSize, _options)
+        };
+        success &= p.database->isValid();
+        _partitions.push_back(std::move(p));
+    }
+    l.unlock();
+
+    if (_partitions.empty()) {
+        success &= addPartition();
+    }
+    return success;
+}
+
+template <typename... T>
+bool Database<T...>::addPartition() {
+    QReadLocker readLocker(&_partitionsLock);
+    const qint64 sequence = _partitions.empty()
+            ? 1
+            : _partitions.back().sequence + 1;
+    readLocker.unlock();
+    const auto created = QDateTime::currentDateTime();
+
+    auto db = connection();
+    QSqlQuery insertQuery(db);
+    insertQuery.prepare(
+                "INSERT INTO " + DatabasePrivate::CATALOG_TABLE
+                + "(sequence, created, activations) VALUES(?, ?, 0)");
+    insertQuery.addBindValue(sequence);
+    insertQuery.addBindValue(created.toMSecsSinceEpoch());
+    if (!insertQuery.exec()) {
+        qDebug() << "can not add partition" << insertQuery.lastError().text();
+        return false;
+    }
+
+    auto database = std::make_unique<Database<T...>>(
+                partitionPath(sequence), _maxDatabaseSize, _options);
+    const bool valid = database->isValid();
+    QWriteLocker l(&_partitionsLock);
+    for (const auto& setup : _partitionSetup) {
+        setup(database.get());
+    }
+    _partitions.push_back(Partition{ sequence, created, 0, std::move(database) });
+    l.unlock();
+    _writesSinceSizeCheck = 0;
+
+    if (_partitionPolicy.maxPartitions > 0) {
+        while (partitionsCount() > _partitionPolicy.maxPartitions
+               && removablePartitionIndex() >= 0) {
+            removeOldestPartition();
+        }
+    }
+    return valid;
+}
+
+template <typename... T>
+int Database<T...>::removablePartitionIndex() const {
+    QReadLocker l(&_partitionsLock);
+    return removablePartitionIndexLocked();
+}
+
+template <typename... T>
+int Database<T...>::removablePartitionIndexLocked() const {
+    for (size_t i = 0; i + 1u < _partitions.size(); ++i) {
+        if (_partitions.at(i).sequence != _activationSequence) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+template <typename... T>
+qint64 Database<T...>::removeOldestPartition() {
+    QWriteLocker l(&_partitionsLock);
+    const auto index = removablePartitionIndexLocked();
+    if (index < 0) {
+        return 0;
+    }
+    auto oldest = std::move(_partitions.at(size_t(index)));
+    _partitions.erase(_partitions.begin() + index);
+    l.unlock();
+
+    const auto tablesCount = sizeof...(T);
+    const auto removed = oldest.database->recordsCountImpl(
+                std::make_index_sequence<tablesCount>{});
+    const auto path = partitionPath(oldest.sequence);
+    oldest.database.reset();
+
+    auto db = connection();
+    QSqlQuery deleteQuery(db);
+    deleteQuery.prepare(
+                "DELETE FROM " + DatabasePrivate::CATALOG_TABLE
+                + " WHERE sequence = ?");
+    deleteQuery.addBindValue(oldest.sequence);
+    if (!deleteQuery.exec()) {
+        qDebug() << "can not remove partition from catalog"
+            << deleteQuery.lastError().text();
+    }
+    for (const auto& suffix : {"", "-wal", "-shm", "-journal"}) {
+        QFile::remove(path + suffix);
+    }
+    return removed;
+}
+
+template <typename... T>
+void Database<T...>::rollPartitionIfNeeded() {
+    // Activation record is written to partition counting it
+    if (_activationPending) {
+        return;
+    }
+    bool needRoll = false;
+    {
+        QReadLocker l(&_partitionsLock);
+        const auto& current = _partitions.back();
+        if (_partitionPolicy.period == PartitionPolicy::Period::Day
+                && current.created.date() != QDate::currentDate()) {
+            needRoll = true;
+        }
+        else if (_partitionPolicy.maxPartitionSize > 0
+                 && ++_writesSinceSizeCheck
+                    >= DatabasePrivate::PARTITION_SIZE_CHECK_INTERVAL) {
+            _writesSinceSizeCheck = 0;
+            needRoll = current.database->usedSize()
+                    > _partitionPolicy.maxPartitionSize;
+        }
+    }
+    if (needRoll) {
+        addPartition();
+    }
+}
+
+template <typename... T>
+Database<T...>* Database<T...>::currentPartition() const {
+    Q_ASSERT(!_partitions.empty());
+    return _partitions.back().database.get();
+}
+
+template <typename... T>
+Database<T...>* Database<T...>::partition(qint64 sequence) const {
+    auto it = std::lower_bound(
+                _partitions.begin(), _partitions.end(), sequence,
+                [](const Partition& p, qint64 s) { return p.sequence < s; });
+    if (it == _partitions.end() || it->sequence != sequence) {
+        return nullptr;
+    }
+    return it->database.get();
+}
+
+template <typename... T>
+QString Database<T...>::partitionPath(qint64 sequence) const {
+    return DatabaseDetail::partitionFilePath(_path, sequence);
+}
+
+template <typename... T>
+qint64 Database<T...>::pragmaValue(const QString& pragma) const {
+    auto db = connection();
+    QSqlQuery pragmaQuery(db);
+    if (!pragmaQuery.exec("PRAGMA " + pragma) || !pragmaQuery.next()) {
+        qDebug() << "can not get" << pragma << pragmaQuery.lastError().text();
+        return -1;
+    }
+    return pragmaQuery.value(0).toLongLong();
+}
+
+template <typename... T>
+template <typename Reader, typename F>
+bool Database<T...>::forEachColumnsRow(const QString& queryString, F f) const {
+    auto db = connection();
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    // Values are decoded from statement without QVariant
+    if constexpr (Reader::direct) {
+        if (auto handle = DatabaseDetail::sqliteHandle(db)) {
+            const auto utf8 = queryString.toUtf8();
+            sqlite3_stmt* statement = nullptr;
+            if (sqlite3_prepare_v2(handle, utf8.constData(), utf8.size(),
+                                   &statement, nullptr) != SQLITE_OK) {
+                qDebug() << "read columns prepare error" << sqlite3_errmsg(handle);
+                return false;
+            }
+            int stepResult;
+            while ((stepResult = sqlite3_step(statement)) == SQLITE_ROW) {
+                if (!f(statement)) {
+                    stepResult = SQLITE_DONE;
+                    break;
+                }
+            }
+            if (stepResult != SQLITE_DONE) {
+                qDebug() << "read columns error" << sqlite3_errmsg(handle);
+            }
+            sqlite3_finalize(statement);
+            return stepResult == SQLITE_DONE;
+        }
+    }
+#endif
+    QSqlQuery readQuery(db);
+    readQuery.setForwardOnly(true);
+    readQuery.prepare(queryString);
+    if (!readQuery.exec()) {
+        qDebug() << "read columns exec error" << readQuery.lastError().text();
+        return false;
+    }
+    while (readQuery.next()) {
+        if (!f(static_cast<const QSqlQuery&>(readQuery))) {
+            break;
+        }
+    }
+    return true;
+}
+
 template <typename... T>
 QString Database<T...>::currentThreadConnectionName() const {
     quintptr pThr = quintptr(QThread::currentThread());
     QString connectionName =
             QString(DatabasePrivate::DB_NAME)
-            + QString::number(qHash(_path))
+            + QString::number(_instanceId)
+            + '_'
             + QString::number(pThr, 16);
     if (!QSqlDatabase::contains(connectionName)) {
-        QSqlDatabase::addDatabase(DatabasePrivate::DB_TYPE, connectionName)
-                .setDatabaseName(_path);
+        auto db = QSqlDatabase::addDatabase(DatabasePrivate::DB_TYPE, connectionName);
+        db.setDatabaseName(_path);
+        configureConnection(db);
         _connectionsMutex.lock();
         _connections.append(connectionName);
         _connectionsMutex.unlock();
@@ -931,6 +2254,30 @@ QString Database<T...>::currentThreadConnectionName() const {
     return connectionName;
 }
 
+template <typename... T>
+void Database<T...>::configureConnection(QSqlDatabase& db) const {
+    const auto pragmas = _options.pragmas();
+    if (pragmas.isEmpty()) {
+        return;
+    }
+    if (_options.busyTimeout >= 0) {
+        db.setConnectOptions(
+                    QString("QSQLITE_BUSY_TIMEOUT=")
+                    + QString::number(_options.busyTimeout));
+    }
+    if (!db.open()) {
+        qDebug() << "can not open" << _path << db.lastError().text();
+        return;
+    }
+    QSqlQuery pragmaQuery(db);
+    for (const auto& pragma : pragmas) {
+        if (!pragmaQuery.exec(pragma)) {
+            qDebug() << "can not apply" << pragma
+                << pragmaQuery.lastError().text();
+        }
+    }
+}
+
 #include <QtDebugPrint/undefdebug.h>
 
 #endif // DATABASE_H
@@ -11,17 +11,68 @@
 
 #include <QString>
 #include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
 #include <QVariant>
 
+#include <QSqlDatabase>
+#include <QSqlDriver>
 #include <QSqlQuery>
 #include <QSqlRecord>
 
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+#include <QDebug>
+#include <sqlite3.h>
+#endif
+
 #include "QtTupleConversions/conversions.h"
 #include "QtTupleConversions/structconversions.h"
 #include "QtTupleConversions/typelist.h"
 
+#include "columntraits.h"
+#include "interned.h"
+#include "timestamp.h"
+#include "private/stringdictionary.h"
+
 namespace DatabaseDetail {
 
+/**
+ * @brief Default maximum size of database file in kilobytes
+ */
+const int defaultMaxDatabaseSize = 2097152; // 2 Gb
+
+/**
+ * @brief Count of low bits of partitioned database row id
+ * that hold row id inside partition, high bits hold
+ * partition sequence number
+ */
+const int partitionRowIdBits = 40;
+
+inline qint64 partitionRowId(qint64 sequence, qint64 localRowId) {
+    return (sequence << partitionRowIdBits) | localRowId;
+}
+
+inline qint64 partitionSequence(qint64 rowId) {
+    return rowId >> partitionRowIdBits;
+}
+
+inline qint64 localRowId(qint64 rowId) {
+    return rowId & ((qint64(1) << partitionRowIdBits) - 1);
+}
+
+/**
+ * @brief partitionFilePath
+ * @return path of partition file next to catalog file,
+ * e.g. events_000003.db for events.db
+ */
+inline QString partitionFilePath(const QString& catalogPath, qint64 sequence) {
+    const QFileInfo catalog(catalogPath);
+    return catalog.dir().filePath(
+                catalog.completeBaseName()
+                + QString("_%1").arg(sequence, 6, 10, QChar('0'))
+                + (catalog.suffix().isEmpty() ? QString() : "." + catalog.suffix()));
+}
+
 template <typename T>
 /**
  * @brief SQL type of T
@@ -47,8 +98,7 @@ constexpr QString sqlTypeName() {
         return "INTEGER";
     }
     else {
-        // TODO static_assert
-        return "Unknown";
+        return ColumnTraits<T>::sqlTypeName();
     }
 }
 
@@ -70,12 +120,12 @@ struct Selector<Tuple, std::index_sequence<Is...>> {
         ((
         res += ((Is != 0) ? ", _" : "_"),
         res += QString::number(Is),
-        res += Conversions::typeName<
+        res += ColumnTraits<
                      typename std::tuple_element<
                          Is,
                          TupleType
                          >::type
-                      >(),
+                      >::typeName(),
         res += " ",
         res += sqlTypeName<
                 typename std::tuple_element<
@@ -93,12 +143,12 @@ struct Selector<Tuple, std::index_sequence<Is...>> {
         list.append(
                 QString('_')
                 + QString::number(Is)
-                + Conversions::typeName<
+                + ColumnTraits<
                      typename std::tuple_element<
                          Is,
                          TupleType
                          >::type
-                      >())
+                      >::typeName())
         ),...);
         return list;
     }
@@ -255,6 +305,33 @@ constexpr QString createTableQuery() {
     return res;
 }
 
+template <typename... T, size_t... Is>
+inline QString schemaQuery(std::index_sequence<Is...>) {
+    return (QString() + ... + createTableQuery<T, Is>());
+}
+
+/**
+ * @brief schemaHash<T...>
+ * FNV-1a hash of create queries of all tables, so it changes
+ * with names and types of columns. Stored in PRAGMA user_version,
+ * computed once per set of types
+ * @return positive 31-bit hash, 0 means no schema
+ */
+template <typename... T>
+inline qint64 schemaHash() {
+    static const qint64 hash = []() {
+        const auto schema = schemaQuery<T...>(std::index_sequence_for<T...>{}).toUtf8();
+        quint32 h = 2166136261u;
+        for (const char c : schema) {
+            h ^= quint8(c);
+            h *= 16777619u;
+        }
+        h &= 0x7fffffffu;
+        return qint64(h != 0 ? h : 1);
+    }();
+    return hash;
+}
+
 /**
  * @brief addRecordQuery<T, tableindex>
  * @param T - Type stored in table
@@ -295,27 +372,102 @@ constexpr QString updateRecordQuery(size_t rowId) {
     return res;
 }
 
+/**
+ * @brief The InternContext struct
+ * Dictionary of database and connection of current thread
+ * used to bind and resolve Interned values
+ */
+struct InternContext {
+    StringDictionary* dictionary;
+    QSqlDatabase db;
+};
+
+template <typename Tuple>
+struct HasInternedElement;
+
+template <typename... Args>
+struct HasInternedElement<std::tuple<Args...>>
+        : std::integral_constant<bool, (IsInterned<std::decay_t<Args>>{} || ...)> {};
+
+/**
+ * @brief HasInternedV
+ * true if struct T has Interned members
+ */
+template <typename T>
+inline constexpr bool HasInternedV = HasInternedElement<
+    typename StructConversions::StructExtractor<T>::TupleType>::value;
+
+/**
+ * @brief resolveInterned
+ * Sets string of Interned value read from database
+ */
+template <typename V>
+void resolveInterned(V& value, const InternContext* context) {
+    if constexpr (IsInterned<V>{}) {
+        if (context != nullptr && value.id() >= 0) {
+            value = V(value.id(), context->dictionary->value(context->db, value.id()));
+        }
+    }
+    else {
+        Q_UNUSED(value);
+        Q_UNUSED(context);
+    }
+}
+
+template <typename Tuple, size_t... Is>
+void resolveInternedTuple(Tuple& tuple, const InternContext* context, std::index_sequence<Is...>) {
+    ((resolveInterned(std::get<Is>(tuple), context)), ...);
+}
+
+template <typename... Args>
+void resolveInternedTuple(std::tuple<Args...>& tuple, const InternContext* context) {
+    resolveInternedTuple(tuple, context, std::index_sequence_for<Args...>{});
+}
+
 template <typename Tuple, typename Sequence>
 struct QueryFillerFromTuple;
 
 template<typename Tuple, size_t... Is>
 struct QueryFillerFromTuple<Tuple, std::index_sequence<Is...>> {
-    static void populateSqlQuery(QSqlQuery& query, const Tuple& tuple) {
+    static void populateSqlQuery(
+            QSqlQuery& query, const Tuple& tuple, const InternContext* context)
+    {
         ((
-        query.addBindValue(Conversions::toStoredDataValue(std::get<Is>(tuple)))
+        query.addBindValue(storedValue(std::get<Is>(tuple), context))
         ), ...);
     }
+
+private:
+    template <typename V>
+    static QVariant storedValue(const V& value, const InternContext* context) {
+        if constexpr (IsInterned<V>{}) {
+            if (context != nullptr) {
+                const auto id = context->dictionary->intern(context->db, value.value());
+                return id >= 0 ? QVariant(id) : QVariant();
+            }
+        }
+        Q_UNUSED(context);
+        return ColumnTraits<V>::toStored(value);
+    }
 };
 
 // TODO make constexpr
+/**
+ * @brief populateSqlQuery
+ * Binds members of val to query
+ * @param context dictionary to intern strings of Interned members
+ */
 template <typename T>
-/*constexpr*/ void populateSqlQuery(QSqlQuery& query, const T& val) {
+/*constexpr*/ void populateSqlQuery(
+        QSqlQuery& query, const T& val,
+        const InternContext* context = nullptr)
+{
     auto t = TupleConversions::makeTuple(val);
     const size_t size = std::tuple_size_v<decltype(t)>;
 
     DatabaseDetail::QueryFillerFromTuple<
             decltype(t), std::make_index_sequence<size>
-            >::populateSqlQuery(query, t);
+            >::populateSqlQuery(query, t, context);
 }
 
 
@@ -337,18 +489,27 @@ struct RecordExtractor<Type, std::index_sequence<Is...>> {
         return t;
     }
 
+    /*
+     * Values are taken from current row of query without
+     * building QSqlRecord with field names for each row
+     */
+    static auto extract(const QSqlQuery& query) {
+        auto t = std::make_tuple(extractField<Is>(query.value(int(Is))) ...);
+        return t;
+    }
+
 private:
 
     template <size_t index>
     static auto extractField(const QVariant& var) {
         using TupleType = typename StructConversions::StructExtractor<Type>::TupleType;
         using FieldType = typename std::decay_t<std::tuple_element_t<index, TupleType>>;
-        return Conversions::fromStoredVariant<FieldType>(var);
+        return ColumnTraits<FieldType>::fromStored(var);
     }
 };
 
-template<typename T>
-auto extractRecord(const QSqlRecord& record) {
+template<typename T, typename Source>
+auto extractRecord(const Source& record) {
     //using TupleType = typename StructConversions::StructExtractor<T>::TupleType;
     const size_t tupleSize = StructConversions::StructExtractor<T>::size;
     auto t = RecordExtractor<T, std::make_index_sequence<tupleSize>>::extract(record);
@@ -371,6 +532,71 @@ inline QString removeHalfRecordsQuery() {
     return query;
 }
 
+template <size_t tableIndex>
+inline QString removeOldestRecordsQuery(int count) {
+    QString query;
+    query += "DELETE FROM ";
+    query += DatabaseDetail::tableName<tableIndex>();
+    query += " WHERE _rowid_ IN (SELECT _rowid_ FROM ";
+    query += DatabaseDetail::tableName<tableIndex>();
+    query += " ORDER BY _rowid_ LIMIT ";
+    query += QString::number(count);
+    query += ")";
+    return query;
+}
+
+template <size_t tableIndex>
+inline QString removeRecordsQuery(QString filterQuery, uint count) {
+    QString query;
+    query += "DELETE FROM ";
+    query += DatabaseDetail::tableName<tableIndex>();
+    query += " WHERE _rowid_ IN (SELECT _rowid_ FROM ";
+    query += DatabaseDetail::tableName<tableIndex>();
+    query += filterQuery;
+    query += " ORDER BY _rowid_";
+    if (count != 0u) {
+        query += " LIMIT ";
+        query += QString::number(count);
+    }
+    query += ")";
+    return query;
+}
+
+template <typename T, size_t tableIndex, size_t columnIndex>
+inline QString createIndexQuery() {
+    const auto column = DatabaseDetail::columnName<T, columnIndex>();
+    QString query = "CREATE INDEX IF NOT EXISTS ";
+    query += DatabaseDetail::tableName<tableIndex>();
+    query += "_";
+    query += column;
+    query += " ON ";
+    query += DatabaseDetail::tableName<tableIndex>();
+    query += "(";
+    query += column;
+    query += ")";
+    return query;
+}
+
+/**
+ * @brief rowIdSpanQuery
+ * @return Query of row ids range width, 0 for empty table
+ */
+template <size_t tableIndex>
+inline QString rowIdSpanQuery() {
+    QString query = "SELECT IFNULL(MAX(_rowid_) - MIN(_rowid_) + 1, 0) FROM ";
+    query += DatabaseDetail::tableName<tableIndex>();
+    return query;
+}
+
+/**
+ * @brief usedSizeQuery
+ * @return Query of size of used pages in bytes
+ */
+inline QString usedSizeQuery() {
+    return "SELECT (page_count - freelist_count) * page_size"
+           " FROM pragma_page_count(), pragma_freelist_count(), pragma_page_size()";
+}
+
 // TODO make constexpr
 //constexpr
 template <size_t tableIndex>
@@ -417,6 +643,357 @@ inline QString readQuery(uint offset, uint count, QString filterQuery) {
     return res;
 }
 
+/**
+ * @brief ColumnTypeT
+ * Type of struct T member stored in column index
+ */
+template <typename T, size_t index>
+using ColumnTypeT = std::decay_t<std::tuple_element_t<
+    index,
+    typename StructConversions::StructExtractor<T>::TupleType>>;
+
+/**
+ * @brief readColumnsQuery<T, tableIndex, Cols...>
+ * @return Query of columns Cols of records passing filter,
+ * ordered by row id so offset and count select stable ranges
+ */
+template <typename T, size_t tableIndex, size_t... Cols>
+inline QString readColumnsQuery(uint offset, uint count, const QString& filterQuery) {
+    const auto names = DatabaseDetail::columnNames<T>();
+    QStringList selected;
+    ((
+    selected.append(names.at(int(Cols)))
+    ), ...);
+    QString res = "SELECT ";
+    res += selected.join(", ");
+    res += " FROM ";
+    res += DatabaseDetail::tableName<tableIndex>();
+    res += filterQuery;
+    res += " ORDER BY _rowid_";
+    if (count != 0u || offset != 0u) {
+        // OFFSET needs LIMIT, -1 is no limit
+        res += " LIMIT ";
+        res += count != 0u ? QString::number(count) : QString("-1");
+    }
+    if (offset != 0u) {
+        res += " OFFSET ";
+        res += QString::number(offset);
+    }
+    return res;
+}
+
+/**
+ * @brief The ColumnDecoder struct
+ * Decodes column value of type T from query.
+ * With system SQLite types having direct decoder
+ * are read from statement without QVariant
+ */
+template <typename T, typename Enable = void>
+struct ColumnDecoder {
+    static constexpr bool direct = false;
+
+    static T fromQuery(const QSqlQuery& query, int index) {
+        return ColumnTraits<T>::fromStored(query.value(index));
+    }
+};
+
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+/**
+ * @brief sqliteHandle
+ * Handle may be passed to linked SQLite only if QSQLITE driver
+ * uses same library, i.e. Qt is built with -system-sqlite.
+ * Versions of both are compared once as a check of that
+ * @return native handle of opened SQLite connection, nullptr if
+ * driver is not SQLite or its SQLite differs from linked one
+ */
+inline sqlite3* sqliteHandle(const QSqlDatabase& db) {
+    const QVariant handle = db.driver()->handle();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        return nullptr;
+    }
+    const auto sqlite = *static_cast<sqlite3* const*>(handle.constData());
+    if (sqlite == nullptr) {
+        return nullptr;
+    }
+    static const bool sameLibrary = [&db]() {
+        QSqlQuery versionQuery(db);
+        const bool same = versionQuery.exec("SELECT sqlite_version()")
+                && versionQuery.next()
+                && versionQuery.value(0).toString()
+                    == QString::fromLatin1(sqlite3_libversion());
+        if (!same) {
+            qDebug() << "SQLite of Qt driver is not linked SQLite"
+                << sqlite3_libversion() << "- direct access disabled";
+        }
+        return same;
+    }();
+    return sameLibrary ? sqlite : nullptr;
+}
+
+template <typename T>
+struct DirectColumnDecoder {
+    static constexpr bool direct = true;
+
+    static T fromQuery(const QSqlQuery& query, int index) {
+        return ColumnTraits<T>::fromStored(query.value(index));
+    }
+    static T fromStatement(sqlite3_stmt* statement, int index) {
+        return T(sqlite3_column_int64(statement, index));
+    }
+};
+
+template <>
+struct ColumnDecoder<int> : DirectColumnDecoder<int> {};
+template <>
+struct ColumnDecoder<qint64> : DirectColumnDecoder<qint64> {};
+
+template <>
+struct ColumnDecoder<bool> : DirectColumnDecoder<bool> {
+    static bool fromStatement(sqlite3_stmt* statement, int index) {
+        return sqlite3_column_int64(statement, index) != 0;
+    }
+};
+
+template <typename T>
+struct ColumnDecoder<T, std::enable_if_t<
+        ColumnTraitsDetail::IsSmallInteger<T>{} || std::is_enum<T>{}>>
+        : DirectColumnDecoder<T> {};
+
+template <>
+struct ColumnDecoder<float> : DirectColumnDecoder<float> {
+    static float fromStatement(sqlite3_stmt* statement, int index) {
+        return float(sqlite3_column_double(statement, index));
+    }
+};
+
+template <>
+struct ColumnDecoder<Timestamp> : DirectColumnDecoder<Timestamp> {
+    static Timestamp fromStatement(sqlite3_stmt* statement, int index) {
+        if (sqlite3_column_type(statement, index) == SQLITE_NULL) {
+            return Timestamp();
+        }
+        return Timestamp(sqlite3_column_int64(statement, index));
+    }
+};
+
+template <typename T>
+struct ColumnDecoder<Interned<T>> : DirectColumnDecoder<Interned<T>> {
+    static Interned<T> fromStatement(sqlite3_stmt* statement, int index) {
+        if (sqlite3_column_type(statement, index) == SQLITE_NULL) {
+            return Interned<T>();
+        }
+        return Interned<T>::fromId(sqlite3_column_int64(statement, index));
+    }
+};
+
+template <typename T, typename = void>
+struct HasFromBlob : std::false_type {};
+template <typename T>
+struct HasFromBlob<T, std::void_t<decltype(ColumnTraits<T>::fromBlob(nullptr, 0))>>
+        : std::true_type {};
+
+/*
+ * Types with ColumnTraits::fromBlob, e.g. packed arrays
+ */
+template <typename T>
+struct ColumnDecoder<T, std::enable_if_t<HasFromBlob<T>{}>>
+        : DirectColumnDecoder<T> {
+    static T fromStatement(sqlite3_stmt* statement, int index) {
+        return ColumnTraits<T>::fromBlob(
+                    static_cast<const char*>(sqlite3_column_blob(statement, index)),
+                    sqlite3_column_bytes(statement, index));
+    }
+};
+
+template <>
+struct ColumnDecoder<double> : DirectColumnDecoder<double> {
+    static double fromStatement(sqlite3_stmt* statement, int index) {
+        return sqlite3_column_double(statement, index);
+    }
+};
+
+template <>
+struct ColumnDecoder<QString> : DirectColumnDecoder<QString> {
+    static QString fromStatement(sqlite3_stmt* statement, int index) {
+        const auto text = sqlite3_column_text16(statement, index);
+        const auto bytes = sqlite3_column_bytes16(statement, index);
+        return QString(static_cast<const QChar*>(text), bytes / 2);
+    }
+};
+
+/*
+ * QDateTime is stored as milliseconds since epoch
+ */
+template <>
+struct ColumnDecoder<QDateTime> : DirectColumnDecoder<QDateTime> {
+    static QDateTime fromStatement(sqlite3_stmt* statement, int index) {
+        if (sqlite3_column_type(statement, index) == SQLITE_NULL) {
+            return QDateTime();
+        }
+        return QDateTime::fromMSecsSinceEpoch(sqlite3_column_int64(statement, index));
+    }
+};
+
+template <>
+struct ColumnDecoder<QByteArray> : DirectColumnDecoder<QByteArray> {
+    static QByteArray fromStatement(sqlite3_stmt* statement, int index) {
+        const auto data = sqlite3_column_blob(statement, index);
+        const auto bytes = sqlite3_column_bytes(statement, index);
+        return QByteArray(static_cast<const char*>(data), bytes);
+    }
+};
+
+/**
+ * @brief borrowFromStatement
+ * Same as ColumnDecoder<T>::fromStatement, but QString and QByteArray
+ * share memory of statement, it is valid until next step of statement
+ */
+template <typename T>
+T borrowFromStatement(sqlite3_stmt* statement, int index) {
+    if constexpr (std::is_same<T, QByteArray>{}) {
+        const auto data = sqlite3_column_blob(statement, index);
+        const auto bytes = sqlite3_column_bytes(statement, index);
+        return QByteArray::fromRawData(static_cast<const char*>(data), bytes);
+    }
+    else if constexpr (std::is_same<T, QString>{}) {
+        const auto text = sqlite3_column_text16(statement, index);
+        const auto bytes = sqlite3_column_bytes16(statement, index);
+        return QString::fromRawData(static_cast<const QChar*>(text), bytes / 2);
+    }
+    else {
+        return ColumnDecoder<T>::fromStatement(statement, index);
+    }
+}
+#endif
+
+template <typename T, size_t... Cols>
+struct ColumnsReader {
+    using Columns = std::tuple<std::vector<ColumnTypeT<T, Cols>>...>;
+    using Indices = std::index_sequence_for<std::integral_constant<size_t, Cols>...>;
+
+    static void reserve(Columns& columns, size_t size) {
+        reserveImpl(columns, size, Indices{});
+    }
+
+    static void appendRow(Columns& columns, const QSqlQuery& query) {
+        appendRowImpl(columns, query, Indices{});
+    }
+
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    static constexpr bool direct = (ColumnDecoder<ColumnTypeT<T, Cols>>::direct && ...);
+
+    static void appendRow(Columns& columns, sqlite3_stmt* statement) {
+        appendStatementRowImpl(columns, statement, Indices{});
+    }
+#endif
+
+    static void appendColumns(Columns& to, Columns&& from) {
+        appendColumnsImpl(to, std::move(from), Indices{});
+    }
+
+    static void resolveInterned(Columns& columns, const InternContext* context) {
+        resolveInternedImpl(columns, context, Indices{});
+    }
+
+    /**
+     * @brief visitRow
+     * Calls f with values of columns
+     * @return result of f
+     */
+    template <typename F>
+    static bool visitRow(F& f, const QSqlQuery& query, const InternContext* context) {
+        return visitRowImpl(f, query, context, Indices{});
+    }
+
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    template <typename F>
+    static bool visitRow(F& f, sqlite3_stmt* statement, const InternContext* context) {
+        return visitStatementRowImpl(f, statement, context, Indices{});
+    }
+#endif
+
+private:
+    template <size_t... Is>
+    static void reserveImpl(Columns& columns, size_t size, std::index_sequence<Is...>) {
+        ((std::get<Is>(columns).reserve(size)), ...);
+    }
+
+    template <size_t... Is>
+    static void appendRowImpl(
+            Columns& columns, const QSqlQuery& query, std::index_sequence<Is...>)
+    {
+        ((
+        std::get<Is>(columns).push_back(
+                ColumnDecoder<ColumnTypeT<T, Cols>>::fromQuery(query, int(Is)))
+        ), ...);
+    }
+
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    template <size_t... Is>
+    static void appendStatementRowImpl(
+            Columns& columns, sqlite3_stmt* statement, std::index_sequence<Is...>)
+    {
+        ((
+        std::get<Is>(columns).push_back(
+                ColumnDecoder<ColumnTypeT<T, Cols>>::fromStatement(statement, int(Is)))
+        ), ...);
+    }
+#endif
+
+    template <typename V>
+    static V resolved(V value, const InternContext* context) {
+        DatabaseDetail::resolveInterned(value, context);
+        return value;
+    }
+
+    template <size_t... Is>
+    static void resolveInternedImpl(
+            Columns& columns, const InternContext* context, std::index_sequence<Is...>)
+    {
+        ((
+        [&columns, context]() {
+            if constexpr (IsInterned<ColumnTypeT<T, Cols>>{}) {
+                for (auto& value : std::get<Is>(columns)) {
+                    DatabaseDetail::resolveInterned(value, context);
+                }
+            }
+        }()
+        ), ...);
+    }
+
+    template <typename F, size_t... Is>
+    static bool visitRowImpl(
+            F& f, const QSqlQuery& query,
+            const InternContext* context, std::index_sequence<Is...>)
+    {
+        return f(resolved(
+                     ColumnDecoder<ColumnTypeT<T, Cols>>::fromQuery(query, int(Is)),
+                     context)...);
+    }
+
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    template <typename F, size_t... Is>
+    static bool visitStatementRowImpl(
+            F& f, sqlite3_stmt* statement,
+            const InternContext* context, std::index_sequence<Is...>)
+    {
+        return f(resolved(
+                     borrowFromStatement<ColumnTypeT<T, Cols>>(statement, int(Is)),
+                     context)...);
+    }
+#endif
+
+    template <size_t... Is>
+    static void appendColumnsImpl(Columns& to, Columns&& from, std::index_sequence<Is...>) {
+        ((
+        std::get<Is>(to).insert(
+                std::get<Is>(to).end(),
+                std::make_move_iterator(std::get<Is>(from).begin()),
+                std::make_move_iterator(std::get<Is>(from).end()))
+        ), ...);
+    }
+};
+
 template <typename List>
 struct OneLength;
 
@@ -0,0 +1,298 @@
+#ifndef DATABASEFANOUT_H
+#define DATABASEFANOUT_H
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <QSemaphore>
+#include <QVector>
+
+#include "database.h"
+#include "private/workerthread.h"
+
+/**
+ * @brief The DatabaseFanOut class
+ * Runs same request on several databases (shards) in parallel.
+ * Each shard is queried by its own thread owned by this object,
+ * so each shard has one connection for fan-out requests,
+ * closed when shard is destroyed.
+ * Shards are separate Database instances, e.g. archive files;
+ * partitions of partitioned Database are read by Database itself.
+ * Methods block until all shards answer, so call them
+ * from worker thread, not from gui thread.
+ * Shards must outlive this object
+ */
+template <typename... T>
+class DatabaseFanOut
+{
+public:
+    explicit DatabaseFanOut(QVector<Database<T...>*> shards);
+    ~DatabaseFanOut();
+
+    DatabaseFanOut(const DatabaseFanOut&) = delete;
+    DatabaseFanOut& operator=(const DatabaseFanOut&) = delete;
+
+    QVector<Database<T...>*> shards() const;
+
+    /**
+     * @brief map
+     * Calls f(shard) for each shard in parallel
+     * @return results in order of shards
+     */
+    template <typename F, typename R = std::invoke_result_t<F, Database<T...>*>>
+    QVector<R> map(F f) const;
+
+    /**
+     * @brief aggregate
+     * Calls f(shard) for each shard in parallel
+     * and folds results with reduce(accumulated, result)
+     */
+    template <typename F, typename Reduce, typename R>
+    R aggregate(F f, Reduce reduce, R init) const;
+
+    /**
+     * @brief numberOfRecords
+     * @return sum of records count of all shards, -1 if any shard fails
+     */
+    template <
+            size_t tableIndex,
+            typename FilterType = Filter<
+                typename Conversions::TypeAtT<
+                    Conversions::TypeList<T...>, tableIndex
+                    >,
+                FilterDetail::Blank>>
+    qint64 numberOfRecords(FilterType filter = FilterType()) const;
+
+    /**
+     * @brief read
+     * Reads offset + count first records of each shard
+     * and merges them in ascending order of key(record)
+     * @param key function returning comparable key of record,
+     * e.g. time of event. Key must not decrease with row id
+     * inside each shard, since shards are read in order of row ids
+     * @param count count of records to return, 0 for all
+     */
+    template <size_t tableIndex, typename FilterType, typename KeyFunction>
+    QVector<DatabaseRecord<
+        typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>
+    >>
+    read(unsigned offset, unsigned count, FilterType filter, KeyFunction key) const;
+
+    /**
+     * @brief read
+     * Row ids of different files are not comparable,
+     * so records are concatenated in order of shards
+     * and each shard keeps its own order
+     */
+    template <
+            size_t tableIndex,
+            typename FilterType = Filter<
+                typename Conversions::TypeAtT<
+                    Conversions::TypeList<T...>, tableIndex
+                    >,
+                FilterDetail::Blank>>
+    QVector<DatabaseRecord<
+        typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>
+    >>
+    read(unsigned offset, unsigned count, FilterType filter = FilterType()) const;
+
+private:
+    /**
+     * @brief runParallel
+     * Runs task i on thread of shard i,
+     * returns when all tasks are finished
+     */
+    void runParallel(const std::vector<std::function<void()>>& tasks) const;
+
+private:
+    QVector<Database<T...>*> _shards;
+    std::vector<std::unique_ptr<WorkerThread>> _threads;
+
+};
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+template <typename... T>
+DatabaseFanOut<T...>::DatabaseFanOut(QVector<Database<T...>*> shards)
+    : _shards{ shards }
+    , _threads()
+{
+    _threads.reserve(size_t(_shards.size()));
+    for (auto i = 0; i < _shards.size(); ++i) {
+        _threads.push_back(std::make_unique<WorkerThread>());
+    }
+}
+
+template <typename... T>
+DatabaseFanOut<T...>::~DatabaseFanOut() {
+    // Threads are stopped before shards close their connections
+    _threads.clear();
+}
+
+template <typename... T>
+QVector<Database<T...>*> DatabaseFanOut<T...>::shards() const {
+    return _shards;
+}
+
+template <typename... T>
+template <typename F, typename R>
+QVector<R> DatabaseFanOut<T...>::map(F f) const {
+    QVector<R> results(_shards.size());
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(size_t(_shards.size()));
+    for (auto i = 0; i < _shards.size(); ++i) {
+        auto shard = _shards.at(i);
+        auto result = &results[i];
+        tasks.push_back([f, shard, result]() { *result = f(shard); });
+    }
+    runParallel(tasks);
+    return results;
+}
+
+template <typename... T>
+template <typename F, typename Reduce, typename R>
+R DatabaseFanOut<T...>::aggregate(F f, Reduce reduce, R init) const {
+    const auto results = map(f);
+    for (const auto& r : results) {
+        init = reduce(std::move(init), r);
+    }
+    return init;
+}
+
+template <typename... T>
+template <size_t tableIndex, typename FilterType>
+qint64 DatabaseFanOut<T...>::numberOfRecords(FilterType filter) const {
+    const auto counts = map([filter](Database<T...>* shard) {
+        return shard->template numberOfRecords<tableIndex>(filter);
+    });
+    qint64 result = 0;
+    for (auto count : counts) {
+        if (count == uint(-1)) {
+            return -1;
+        }
+        result += count;
+    }
+    return result;
+}
+
+template <typename... T>
+template <size_t tableIndex, typename FilterType, typename KeyFunction>
+QVector<DatabaseRecord<
+    typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>
+>>
+DatabaseFanOut<T...>::read(
+        unsigned offset, unsigned count,
+        FilterType filter, KeyFunction key) const
+{
+    using Record = DatabaseRecord<
+        typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>>;
+    using Key = std::decay_t<std::invoke_result_t<KeyFunction, const Record&>>;
+
+    // Any of first offset + count records may come from one shard
+    const unsigned shardCount = count == 0u ? 0u : offset + count;
+    const auto parts = map([shardCount, filter](Database<T...>* shard) {
+        return shard->template read<tableIndex>(0u, shardCount, filter);
+    });
+
+    // K-way merge, heap holds current head of each shard
+    struct Head {
+        Key key;
+        int shard;
+        int index;
+    };
+    auto greater = [](const Head& l, const Head& r) {
+        return r.key < l.key || (!(l.key < r.key) && r.shard < l.shard);
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+    int total = 0;
+    for (auto i = 0; i < parts.size(); ++i) {
+        total += parts.at(i).size();
+        if (!parts.at(i).isEmpty()) {
+            heads.push(Head{ key(parts.at(i).first()), i, 0 });
+        }
+    }
+
+    QVector<Record> result;
+    result.reserve(count == 0u ? std::max(total - int(offset), 0) : int(count));
+    unsigned skipped = 0u;
+    while (!heads.empty() && (count == 0u || unsigned(result.size()) < count)) {
+        auto head = heads.top();
+        heads.pop();
+        const auto& part = parts.at(head.shard);
+        if (skipped < offset) {
+            ++skipped;
+        }
+        else {
+            result.append(part.at(head.index));
+        }
+        if (++head.index < part.size()) {
+            head.key = key(part.at(head.index));
+            heads.push(std::move(head));
+        }
+    }
+    return result;
+}
+
+template <typename... T>
+template <size_t tableIndex, typename FilterType>
+QVector<DatabaseRecord<
+    typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>
+>>
+DatabaseFanOut<T...>::read(unsigned offset, unsigned count, FilterType filter) const {
+    using Record = DatabaseRecord<
+        typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>>;
+
+    // Page may be taken from one shard
+    const unsigned shardCount = count == 0u ? 0u : offset + count;
+    const auto parts = map([shardCount, filter](Database<T...>* shard) {
+        return shard->template read<tableIndex>(0u, shardCount, filter);
+    });
+
+    QVector<Record> result;
+    unsigned skipped = 0u;
+    for (const auto& part : parts) {
+        for (const auto& record : part) {
+            if (count != 0u && unsigned(result.size()) >= count) {
+                return result;
+            }
+            if (skipped < offset) {
+                ++skipped;
+            }
+            else {
+                result.append(record);
+            }
+        }
+    }
+    return result;
+}
+
+/* ******************************************************************
+ * Private
+ * ******************************************************************
+ */
+
+template <typename... T>
+void DatabaseFanOut<T...>::runParallel(
+        const std::vector<std::function<void()>>& tasks) const
+{
+    Q_ASSERT(tasks.size() <= _threads.size());
+    QSemaphore done;
+    for (auto i = 0u; i < tasks.size(); ++i) {
+        const auto& task = tasks[i];
+        _threads[i]->work([&task, &done]() {
+            task();
+            done.release();
+        });
+    }
+    done.acquire(int(tasks.size()));
+}
+
+#endif // DATABASEFANOUT_H
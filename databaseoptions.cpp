@@ -0,0 +1,157 @@
+#include "databaseoptions.h"
+
+namespace {
+const int defaultBusyTimeout = 5000;
+
+QString journalModeName(DatabaseOptions::JournalMode mode) {
+    switch (mode) {
+    case DatabaseOptions::JournalMode::Delete:
+        return "DELETE";
+    case DatabaseOptions::JournalMode::Truncate:
+        return "TRUNCATE";
+    case DatabaseOptions::JournalMode::Persist:
+        return "PERSIST";
+    case DatabaseOptions::JournalMode::Memory:
+        return "MEMORY";
+    case DatabaseOptions::JournalMode::Wal:
+        return "WAL";
+    case DatabaseOptions::JournalMode::Off:
+        return "OFF";
+    case DatabaseOptions::JournalMode::Default:
+        break;
+    }
+    return QString();
+}
+
+QString synchronousName(DatabaseOptions::Synchronous synchronous) {
+    switch (synchronous) {
+    case DatabaseOptions::Synchronous::Off:
+        return "OFF";
+    case DatabaseOptions::Synchronous::Normal:
+        return "NORMAL";
+    case DatabaseOptions::Synchronous::Full:
+        return "FULL";
+    case DatabaseOptions::Synchronous::Extra:
+        return "EXTRA";
+    case DatabaseOptions::Synchronous::Default:
+        break;
+    }
+    return QString();
+}
+
+QString tempStoreName(DatabaseOptions::TempStore tempStore) {
+    switch (tempStore) {
+    case DatabaseOptions::TempStore::File:
+        return "FILE";
+    case DatabaseOptions::TempStore::Memory:
+        return "MEMORY";
+    case DatabaseOptions::TempStore::Default:
+        break;
+    }
+    return QString();
+}
+
+QString lockingModeName(DatabaseOptions::LockingMode lockingMode) {
+    switch (lockingMode) {
+    case DatabaseOptions::LockingMode::Normal:
+        return "NORMAL";
+    case DatabaseOptions::LockingMode::Exclusive:
+        return "EXCLUSIVE";
+    case DatabaseOptions::LockingMode::Default:
+        break;
+    }
+    return QString();
+}
+
+QString autoVacuumName(DatabaseOptions::AutoVacuum autoVacuum) {
+    switch (autoVacuum) {
+    case DatabaseOptions::AutoVacuum::None:
+        return "NONE";
+    case DatabaseOptions::AutoVacuum::Full:
+        return "FULL";
+    case DatabaseOptions::AutoVacuum::Incremental:
+        return "INCREMENTAL";
+    case DatabaseOptions::AutoVacuum::Default:
+        break;
+    }
+    return QString();
+}
+} // namespace
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+DatabaseOptions DatabaseOptions::maxDurability() {
+    DatabaseOptions options;
+    options.journalMode = JournalMode::Delete;
+    options.synchronous = Synchronous::Extra;
+    options.busyTimeout = defaultBusyTimeout;
+    return options;
+}
+
+DatabaseOptions DatabaseOptions::maxThroughput() {
+    DatabaseOptions options;
+    options.journalMode = JournalMode::Wal;
+    options.synchronous = Synchronous::Normal;
+    options.tempStore = TempStore::Memory;
+    options.cacheSize = 16384; // 16 Mb
+    options.mmapSize = 268435456; // 256 Mb
+    options.busyTimeout = defaultBusyTimeout;
+    options.walAutocheckpoint = 4096;
+    return options;
+}
+
+DatabaseOptions DatabaseOptions::writeAheadLog() {
+    DatabaseOptions options;
+    options.journalMode = JournalMode::Wal;
+    options.busyTimeout = defaultBusyTimeout;
+    return options;
+}
+
+QStringList DatabaseOptions::pragmas() const {
+    QStringList result;
+    // Busy timeout goes first, next pragmas may wait for lock
+    if (busyTimeout >= 0) {
+        result << "PRAGMA busy_timeout=" + QString::number(busyTimeout);
+    }
+    // Page size can not be changed after switch to WAL
+    if (pageSize > 0) {
+        result << "PRAGMA page_size=" + QString::number(pageSize);
+    }
+    // Auto vacuum mode of new file can not be changed after switch to WAL
+    if (autoVacuum != AutoVacuum::Default) {
+        result << autoVacuumPragma();
+    }
+    if (lockingMode != LockingMode::Default) {
+        result << "PRAGMA locking_mode=" + lockingModeName(lockingMode);
+    }
+    if (journalMode != JournalMode::Default) {
+        result << "PRAGMA journal_mode=" + journalModeName(journalMode);
+    }
+    if (synchronous != Synchronous::Default) {
+        result << "PRAGMA synchronous=" + synchronousName(synchronous);
+    }
+    if (cacheSize > 0) {
+        // Negative value is size in kilobytes
+        result << "PRAGMA cache_size=-" + QString::number(cacheSize);
+    }
+    if (mmapSize >= 0) {
+        result << "PRAGMA mmap_size=" + QString::number(mmapSize);
+    }
+    if (tempStore != TempStore::Default) {
+        result << "PRAGMA temp_store=" + tempStoreName(tempStore);
+    }
+    if (walAutocheckpoint >= 0) {
+        result << "PRAGMA wal_autocheckpoint=" + QString::number(walAutocheckpoint);
+    }
+    return result;
+}
+
+QString DatabaseOptions::autoVacuumPragma() const {
+    if (autoVacuum == AutoVacuum::Default) {
+        return QString();
+    }
+    return "PRAGMA auto_vacuum=" + autoVacuumName(autoVacuum);
+}
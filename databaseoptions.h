@@ -0,0 +1,152 @@
+#ifndef DATABASEOPTIONS_H
+#define DATABASEOPTIONS_H
+
+#include <QtGlobal>
+#include <QStringList>
+
+/**
+ * @brief The DatabaseOptions struct
+ * SQLite settings applied to each connection of Database
+ * when it is opened. Fields left in default state are not set,
+ * so SQLite keeps its own defaults.
+ */
+struct DatabaseOptions
+{
+    enum class JournalMode {
+        Default,
+        Delete,
+        Truncate,
+        Persist,
+        Memory,
+        Wal,
+        Off
+    };
+
+    enum class Synchronous {
+        Default,
+        Off,
+        Normal,
+        Full,
+        Extra
+    };
+
+    enum class TempStore {
+        Default,
+        File,
+        Memory
+    };
+
+    /**
+     * Exclusive locking mode allows only one connection,
+     * so it can not be used with AsyncDatabase reader threads
+     */
+    enum class LockingMode {
+        Default,
+        Normal,
+        Exclusive
+    };
+
+    /**
+     * Auto vacuum mode is applied only when database file is created,
+     * Database::migrateAutoVacuum() changes it for existing file
+     */
+    enum class AutoVacuum {
+        Default,
+        None,
+        Full,
+        Incremental
+    };
+
+    JournalMode journalMode = JournalMode::Default;
+    Synchronous synchronous = Synchronous::Default;
+    TempStore tempStore = TempStore::Default;
+    LockingMode lockingMode = LockingMode::Default;
+    /**
+     * @brief autoVacuum
+     * With incremental mode pages freed by removed records
+     * are returned to file system in small steps
+     * instead of full VACUUM
+     */
+    AutoVacuum autoVacuum = AutoVacuum::Incremental;
+
+    /**
+     * @brief pageSize
+     * Page size in bytes, changes only new database file.
+     * 0 keeps default
+     */
+    int pageSize = 0;
+
+    /**
+     * @brief cacheSize
+     * Page cache size of each connection in kilobytes.
+     * 0 keeps default
+     */
+    int cacheSize = 0;
+
+    /**
+     * @brief mmapSize
+     * Maximum size of memory mapped part of database file in bytes,
+     * 0 disables memory mapping, -1 keeps default
+     */
+    qint64 mmapSize = -1;
+
+    /**
+     * @brief busyTimeout
+     * Time to wait for lock of other connection in milliseconds.
+     * -1 keeps default
+     */
+    int busyTimeout = -1;
+
+    /**
+     * @brief walAutocheckpoint
+     * WAL size in pages that triggers checkpoint,
+     * 0 disables automatic checkpoints, -1 keeps default
+     */
+    int walAutocheckpoint = -1;
+
+    /**
+     * @brief enforceMaxDatabaseSize
+     * AsyncDatabase keeps used size of database below maxDatabaseSize
+     * of Database: oldest records are removed in background when it
+     * is approached. Disabled by default, records are never removed implicitly
+     */
+    bool enforceMaxDatabaseSize = false;
+
+    /**
+     * @brief maxDurability
+     * Rollback journal with full sync of journal directory,
+     * commited transaction survives power loss
+     */
+    static DatabaseOptions maxDurability();
+
+    /**
+     * @brief maxThroughput
+     * WAL journal without sync on each commit, large page cache
+     * and memory mapped reads. Commited transaction may be lost
+     * on power loss, but database stays consistent
+     */
+    static DatabaseOptions maxThroughput();
+
+    /**
+     * @brief writeAheadLog
+     * WAL journal with default sync, so reads from other
+     * threads run concurrently with writes
+     */
+    static DatabaseOptions writeAheadLog();
+
+    /**
+     * @brief pragmas
+     * @return PRAGMA statements in order they must be executed
+     */
+    QStringList pragmas() const;
+
+    /**
+     * @brief autoVacuumPragma
+     * @return PRAGMA statement to set auto vacuum mode,
+     * empty string for default mode
+     */
+    QString autoVacuumPragma() const;
+
+};
+
+#endif // DATABASEOPTIONS_H
@@ -8,7 +8,7 @@
 
 #include "private/databasetableviewmodel.h"
 #include "private/databaseviewmodeldetail.h"
-#include "private/databaseviewmodeldetail_vector.h"
+#include "private/databaseviewmodeldetail_deque.h"
 
 /**
  * @brief The DatabaseViewModel class
@@ -64,7 +64,9 @@ template <typename Tuple, size_t...Is>
 QVariantList tupleToVariantList(Tuple/*&&*/ t, std::index_sequence<Is...>) {
     QVariantList vl;
     ((
-    vl.append(QVariant(std::get<Is>(t)))
+    vl.append(ColumnTraits<
+              std::decay_t<std::tuple_element_t<Is, Tuple>>
+              >::toDisplay(std::get<Is>(t)))
     ), ...);
     return vl;
 }
@@ -1,6 +1,8 @@
 #ifndef EVENTDATABASE_H
 #define EVENTDATABASE_H
 
+#include <atomic>
+
 #include <QDateTime>
 #include <QThread>
 
@@ -30,14 +32,49 @@ public:
             QStringList roles,
             QObject* parent = nullptr
             );
+    /**
+     * @brief EventDatabase
+     * @param partitionPolicy if enabled, events are written
+     * to partition files near databasePath, see PartitionPolicy
+     */
+    EventDatabase(
+            const QString& databasePath,
+            const PartitionPolicy& partitionPolicy,
+            QStringList roles,
+            DatabaseViewModelDetail::Direction activationsListDirection,
+            DatabaseViewModelDetail::Direction dataListDirection,
+            QObject* parent = nullptr
+            );
     ~EventDatabase();
 
     /**
      * @brief addRecord
      * This method is thread-safe
      * @param record
+     * @return false if write queue is full and record was not queued,
+     * see setWriteQueueLimit()
+     */
+    bool addRecord(const T& record);
+
+    /**
+     * @brief setWriteQueueLimit
+     * Limits count of records waiting for write.
+     * This method is thread-safe
+     * @param capacity maximum count of queued writes, 0 for unbounded queue
+     * @param policy what addRecord does when queue is full,
+     * with DropOldest record may be written before tasks
+     * queued earlier, see WorkerThread::OverflowPolicy
+     */
+    void setWriteQueueLimit(
+            int capacity,
+            WorkerThread::OverflowPolicy policy = WorkerThread::OverflowPolicy::FailFast);
+
+    /**
+     * @brief writeQueueStatistics
+     * This method is thread-safe
+     * @return depth and time in queue of database tasks
      */
-    void addRecord(const T& record);
+    WorkerThread::Statistics writeQueueStatistics() const;
 
     /**
      * @brief isPreviousShutdownCorrect
@@ -46,6 +83,29 @@ public:
      */
     bool isPreviousShutdownCorrect() const;
 
+    /**
+     * @brief setRetentionPolicy
+     * Starts periodic removal of old activations with their events.
+     * Removal runs on database thread in small transactions.
+     * This method is NOT thread-safe
+     */
+    void setRetentionPolicy(const EventDatabaseDetail::RetentionPolicy& policy);
+
+    EventDatabaseDetail::RetentionPolicy retentionPolicy() const;
+
+protected:
+    void processRetention() override;
+
+private:
+    /*
+     * Progress of retention passed between its steps
+     */
+    struct RetentionState {
+        QVector<qint64> removedIds;
+        qint64 activationRowId = -1;
+        qint64 activationId = 0;
+    };
+
 private:
     void initDatabases(
             QStringList roles,
@@ -55,13 +115,24 @@ private:
     void updateActivationRecord(bool shutDownCorrect = false);
     void setActivationIndex(uint activationIndex);
     void checkIfPreviousActivationCorrect();
+    void retentionStep(
+            const EventDatabaseDetail::RetentionPolicy& policy,
+            RetentionState state);
+    bool isExpired(
+            const EventDatabaseDetail::RetentionPolicy& policy,
+            const EventDatabaseDetail::Activation& activation);
+    void finishRetention(const QVector<qint64>& removedIds);
+    void reloadAfterRetention(const QVector<qint64>& removedIds);
 
 private:
+    EventDatabaseDetail::RetentionPolicy _retentionPolicy;
+    std::atomic<bool> _retentionRunning;
     AsyncDatabase<
             EventDatabaseDetail::Activation,
             EventDatabaseRecord<T> >
             _database;
     qint64 _activationId;
+    EventDatabaseDetail::EventClock _clock;
     DatabaseTableViewModel<
             Database<
                 EventDatabaseDetail::Activation,
@@ -92,14 +163,35 @@ EventDatabase<T>::EventDatabase(
         DatabaseViewModelDetail::Direction dataListDirection,
         QObject* parent
         )
+    : EventDatabase(
+          databasePath,
+          PartitionPolicy(),
+          roles,
+          activationsListDirection,
+          dataListDirection,
+          parent)
+{}
+
+template <typename T>
+EventDatabase<T>::EventDatabase(
+        const QString& databasePath,
+        const PartitionPolicy& partitionPolicy,
+        QStringList roles,
+        DatabaseViewModelDetail::Direction activationsListDirection,
+        DatabaseViewModelDetail::Direction dataListDirection,
+        QObject* parent
+        )
     : EventDatabasePrivate(
           nullptr,
           nullptr,
           [this](int index){setActivationIndex(index);},
           parent
           )
-    , _database(databasePath)
-    , _activationId(QDateTime::currentDateTime().toMSecsSinceEpoch())
+    , _retentionPolicy()
+    , _retentionRunning{ false }
+    , _database(databasePath, DatabaseOptions::writeAheadLog(), partitionPolicy)
+    , _activationId(QDateTime::currentMSecsSinceEpoch())
+    , _clock(_activationId)
     , _activationModel{ nullptr }
     , _dataModel{ nullptr }
     , _previousShutdownCorrect{ false }
@@ -107,6 +199,14 @@ EventDatabase<T>::EventDatabase(
     initDatabases(roles, activationsListDirection, dataListDirection);
     checkIfPreviousActivationCorrect();
 
+    // Events are filtered and removed by activation id
+    auto db = _database.internalDatabase();
+    _database.internalThread()->work([db]() {
+        db->template createIndex<1u, 0u>();
+        // Partition may be started before activation record is written
+        db->notifyActivation();
+    });
+
     addActivationRecord();
 }
 
@@ -132,14 +232,30 @@ EventDatabase<T>::~EventDatabase() {
 }
 
 template <typename T>
-void EventDatabase<T>::addRecord(const T& record) {
+bool EventDatabase<T>::addRecord(const T& record) {
     Q_ASSERT(_activationModel != nullptr);
-    EventDatabaseRecord<T> r(record, _activationId, QDateTime::currentDateTime());
-    _dataModel->addRecord(r);
+    EventDatabaseRecord<T> r(record, _activationId, _clock.now());
+    if (!_dataModel->addRecord(r)) {
+        return false;
+    }
     if (canUpdateActivationRecord()) {
         denyUpdateActivationRecord();
         updateActivationRecord();
     }
+    return true;
+}
+
+template <typename T>
+void EventDatabase<T>::setWriteQueueLimit(
+        int capacity,
+        WorkerThread::OverflowPolicy policy)
+{
+    _database.internalThread()->setCapacity(capacity, policy);
+}
+
+template <typename T>
+WorkerThread::Statistics EventDatabase<T>::writeQueueStatistics() const {
+    return _database.internalThread()->statistics();
 }
 
 template <typename T>
@@ -147,6 +263,41 @@ bool EventDatabase<T>::isPreviousShutdownCorrect() const {
     return _previousShutdownCorrect;
 }
 
+template <typename T>
+void EventDatabase<T>::setRetentionPolicy(
+        const EventDatabaseDetail::RetentionPolicy& policy)
+{
+    _retentionPolicy = policy;
+    const bool enabled = policy.maxAge > 0
+            || policy.maxActivations > 0
+            || policy.maxEvents > 0;
+    setRetentionInterval(enabled ? policy.checkInterval : 0);
+    if (enabled) {
+        processRetention();
+    }
+}
+
+template <typename T>
+EventDatabaseDetail::RetentionPolicy EventDatabase<T>::retentionPolicy() const {
+    return _retentionPolicy;
+}
+
+/* ******************************************************************
+ * Protected
+ * ******************************************************************
+ */
+
+template <typename T>
+void EventDatabase<T>::processRetention() {
+    if (_retentionRunning.exchange(true)) {
+        return;
+    }
+    const auto policy = _retentionPolicy;
+    _database.internalThread()->work([this, policy]() {
+        retentionStep(policy, RetentionState());
+    });
+}
+
 /* ******************************************************************
  * Private
  * ******************************************************************
@@ -238,6 +389,112 @@ void EventDatabase<T>::checkIfPreviousActivationCorrect() {
     _previousShutdownCorrect = lastActivation.shutdownCorrect;
 }
 
+template <typename T>
+void EventDatabase<T>::retentionStep(
+        const EventDatabaseDetail::RetentionPolicy& policy,
+        RetentionState state)
+{
+    auto db = _database.internalDatabase();
+    if (state.activationRowId < 0) {
+        // Activations are stored in order of start
+        const auto oldest = db->template read<0u>(0u, 1u);
+        if (oldest.isEmpty()
+                || oldest.first().id == _activationId
+                || !isExpired(policy, oldest.first())) {
+            finishRetention(state.removedIds);
+            return;
+        }
+        state.activationRowId = oldest.first().rowId;
+        state.activationId = oldest.first().id;
+    }
+
+    Filter<EventDatabaseRecord<T>, FilterDetail::ActivationId> eventsFilter;
+    eventsFilter.equal().value({state.activationId});
+
+    const bool transaction = db->beginTransaction();
+    auto removed = db->template removeRecords<1u>(
+                eventsFilter, EventDatabaseDetail::retentionBatchSize);
+    bool activationRemoved = false;
+    if (removed >= 0 && uint(removed) < EventDatabaseDetail::retentionBatchSize) {
+        // Activation is removed after last its event.
+        // Filter by id column, row ids of partitioned database are composite
+        Filter<EventDatabaseDetail::Activation, qint64> activationFilter;
+        activationFilter.equal().value(state.activationId);
+        removed = db->template removeRecords<0u>(activationFilter);
+        activationRemoved = removed >= 0;
+    }
+    if (transaction) {
+        if (removed < 0) {
+            db->rollbackTransaction();
+        }
+        else if (!db->commitTransaction()) {
+            removed = -1;
+        }
+    }
+    if (removed < 0) {
+        dbg << "retention failed for activation" << state.activationId;
+        finishRetention(state.removedIds);
+        return;
+    }
+    if (activationRemoved) {
+        state.removedIds.append(state.activationId);
+        state.activationRowId = -1;
+    }
+
+    // Next step is queued, so writes are not delayed by retention
+    _database.internalThread()->work(
+                [this, policy, state = std::move(state)]() mutable {
+        retentionStep(policy, std::move(state));
+    });
+}
+
+template <typename T>
+bool EventDatabase<T>::isExpired(
+        const EventDatabaseDetail::RetentionPolicy& policy,
+        const EventDatabaseDetail::Activation& activation)
+{
+    auto db = _database.internalDatabase();
+    const auto failed = uint(-1);
+    if (policy.maxActivations > 0) {
+        const auto count = db->template numberOfRecords<0u>();
+        if (count != failed && count > uint(policy.maxActivations)) {
+            return true;
+        }
+    }
+    if (policy.maxAge > 0
+            && activation.disableTime.secsTo(QDateTime::currentDateTime()) > policy.maxAge) {
+        return true;
+    }
+    if (policy.maxEvents > 0) {
+        const auto count = db->template numberOfRecords<1u>();
+        if (count != failed && qint64(count) > policy.maxEvents) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+void EventDatabase<T>::finishRetention(const QVector<qint64>& removedIds) {
+    _retentionRunning = false;
+    if (removedIds.isEmpty()) {
+        return;
+    }
+    addGuiTask([this, removedIds]() { reloadAfterRetention(removedIds); });
+}
+
+template <typename T>
+void EventDatabase<T>::reloadAfterRetention(const QVector<qint64>& removedIds) {
+    const auto selected = currentActivation();
+    const bool selectedRemoved =
+            selected < uint(_activationModel->rowCount())
+            && removedIds.contains(_activationModel->recordAt(selected).id);
+    _activationModel->reload();
+    if (selectedRemoved) {
+        _dataModel->reload();
+    }
+}
+
 #include "QtDebugPrint/undefdebug.h"
 
 #endif // EVENTDATABASE_H
@@ -5,19 +5,19 @@
 #include <utility>
 #include <type_traits>
 #include <qglobal.h>
-#include <QDateTime>
 
 #include "QtTupleConversions/structconversions.h"
+#include "timestamp.h"
 
 template <typename T>
 struct EventDatabaseRecord : public T {
-    EventDatabaseRecord(T t, qint64 id, QDateTime time)
+    EventDatabaseRecord(T t, qint64 id, Timestamp time)
         : T(t)
         , id{id}
         , time{time}
     {}
     template <typename... Args>
-    EventDatabaseRecord(qint64 id, QDateTime time, Args ...args)
+    EventDatabaseRecord(qint64 id, Timestamp time, Args ...args)
         : T{args...}
         , id{id}
         , time{time}
@@ -29,7 +29,10 @@ struct EventDatabaseRecord : public T {
     {}
 
     qint64 id; // TODO rename to activationId
-    QDateTime time;
+    /*
+     * Same column as QDateTime, converted by toDateTime() for display
+     */
+    Timestamp time;
 };
 
 namespace std {
@@ -43,7 +46,7 @@ struct tuple_element<0, EventDatabaseRecord<T>> {
 };
 template < typename T>
 struct tuple_element<1, EventDatabaseRecord<T>> {
-    using type = QDateTime;
+    using type = Timestamp;
 };
 template <size_t I, typename T>
 struct tuple_element<I, EventDatabaseRecord<T>> {
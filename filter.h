@@ -179,7 +179,7 @@ constexpr Filter<Struct, Type>& Filter<Struct, Type>::value(Type t) {
             _query += QString::number(t.id);
         }
         else {
-            _query += Conversions::toStoredDataValueString(t);
+            _query += ColumnTraits<Type>::filterLiteral(t);
         }
         _valueSet = true;
     }
@@ -200,6 +200,8 @@ constexpr Filter<Struct, Type>& Filter<Struct, Type>::equal() {
 
 template<typename Struct, typename Type>
 constexpr Filter<Struct, Type>& Filter<Struct, Type>::greater() {
+    static_assert(!IsInterned<Type>{},
+                  "ids of Interned do not follow order of strings, use equal()");
     if (_valueSet || _comparisonType != FilterDetail::ComparisonType::None) {
         return *this;
     }
@@ -212,6 +214,8 @@ constexpr Filter<Struct, Type>& Filter<Struct, Type>::greater() {
 
 template<typename Struct, typename Type>
 constexpr Filter<Struct, Type>& Filter<Struct, Type>::less() {
+    static_assert(!IsInterned<Type>{},
+                  "ids of Interned do not follow order of strings, use equal()");
     if (_valueSet || _comparisonType != FilterDetail::ComparisonType::None) {
         return *this;
     }
@@ -224,6 +228,8 @@ constexpr Filter<Struct, Type>& Filter<Struct, Type>::less() {
 
 template<typename Struct, typename Type>
 constexpr Filter<Struct, Type>& Filter<Struct, Type>::greaterOrEqual() {
+    static_assert(!IsInterned<Type>{},
+                  "ids of Interned do not follow order of strings, use equal()");
     if (_valueSet || _comparisonType != FilterDetail::ComparisonType::None) {
         return *this;
     }
@@ -236,6 +242,8 @@ constexpr Filter<Struct, Type>& Filter<Struct, Type>::greaterOrEqual() {
 
 template<typename Struct, typename Type>
 constexpr Filter<Struct, Type>& Filter<Struct, Type>::lessOrEqual() {
+    static_assert(!IsInterned<Type>{},
+                  "ids of Interned do not follow order of strings, use equal()");
     if (_valueSet || _comparisonType != FilterDetail::ComparisonType::None) {
         return *this;
     }
@@ -0,0 +1,107 @@
+#ifndef INTERNED_H
+#define INTERNED_H
+
+#include <type_traits>
+
+#include <QString>
+#include <QVariant>
+
+#include "columntraits.h"
+#include "private/stringdictionary.h"
+
+/**
+ * @brief The Interned class
+ * String column with few distinct values, e.g. source name or level.
+ * Value is stored in dictionary table of database and column
+ * holds its integer id. Read values share QString data
+ * of dictionary cache of database.
+ * Filters compare ids, which follow order of interning,
+ * not of strings, so only equal() filter compiles
+ */
+template <typename T = QString>
+class Interned
+{
+    static_assert(std::is_same<T, QString>{}, "only QString can be interned");
+public:
+    Interned() : _value(), _id{ -1 } {}
+    Interned(const T& value) : _value{ value }, _id{ -1 } {}
+    Interned(qint64 id, const T& value) : _value{ value }, _id{ id } {}
+
+    /**
+     * @brief fromId
+     * @return value read from database before resolving of string
+     */
+    static Interned fromId(qint64 id) {
+        return Interned(id, T());
+    }
+
+    const T& value() const {
+        return _value;
+    }
+
+    operator const T&() const {
+        return _value;
+    }
+
+    /**
+     * @brief id
+     * @return id of value in dictionary of database it was read from,
+     * -1 for values not read from database
+     */
+    qint64 id() const {
+        return _id;
+    }
+
+    /*
+     * Ids differ between databases, so values are compared
+     */
+    bool operator==(const Interned& other) const {
+        return _value == other._value;
+    }
+    bool operator!=(const Interned& other) const {
+        return !operator==(other);
+    }
+    bool operator<(const Interned& other) const {
+        return _value < other._value;
+    }
+
+private:
+    T _value;
+    qint64 _id;
+
+};
+
+template <typename T>
+struct IsInterned : std::false_type {};
+template <typename T>
+struct IsInterned<Interned<T>> : std::true_type {};
+
+/*
+ * Database binds ids of dictionary and resolves read ids,
+ * see DatabaseDetail::InternContext
+ */
+template <typename T>
+struct ColumnTraits<Interned<T>> {
+    using Type = Interned<T>;
+
+    static QString typeName() {
+        return "Interned" + ColumnTraits<T>::typeName();
+    }
+    static QString sqlTypeName() {
+        return "INTEGER";
+    }
+    static QVariant toStored(const Type& value) {
+        return value.id() >= 0 ? QVariant(value.id()) : QVariant();
+    }
+    static Type fromStored(const QVariant& value) {
+        return value.isNull() ? Type() : Type::fromId(value.toLongLong());
+    }
+    static QString filterLiteral(const Type& value) {
+        return StringDictionary::idQuery(ColumnTraits<T>::filterLiteral(value.value()));
+    }
+    static QVariant toDisplay(const Type& value) {
+        return QVariant(value.value());
+    }
+};
+
+#endif // INTERNED_H
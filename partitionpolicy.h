@@ -0,0 +1,59 @@
+#ifndef PARTITIONPOLICY_H
+#define PARTITIONPOLICY_H
+
+#include <QtGlobal>
+
+/**
+ * @brief The PartitionPolicy struct
+ * Partitioned Database writes records to new file per period,
+ * size or count of activations. Database path holds catalog
+ * of partition files, reads see records of all partitions
+ * as one table. Old data is removed by removing whole
+ * partition file instead of deleting records.
+ * Records of partitioned database have row ids composed
+ * of partition sequence number and row id inside partition,
+ * so FilterDetail::RowId filters are not supported in this mode
+ */
+struct PartitionPolicy
+{
+    enum class Period {
+        None,
+        Day
+    };
+
+    Period period = Period::None;
+
+    /**
+     * @brief maxPartitionSize
+     * Size of used pages of partition in kilobytes
+     * after which next partition is started, 0 disables limit
+     */
+    qint64 maxPartitionSize = 0;
+
+    /**
+     * @brief maxActivations
+     * Count of activations stored in one partition,
+     * see Database::notifyActivation(), 0 disables limit
+     */
+    int maxActivations = 0;
+
+    /**
+     * @brief maxPartitions
+     * Count of kept partitions, oldest partition file
+     * is removed when new one is started, 0 keeps all
+     */
+    int maxPartitions = 0;
+
+    /**
+     * @brief isEnabled
+     * @return true if database must be partitioned
+     */
+    bool isEnabled() const {
+        return period != Period::None
+                || maxPartitionSize > 0
+                || maxActivations > 0;
+    }
+
+};
+
+#endif // PARTITIONPOLICY_H
@@ -1,10 +1,70 @@
 #ifndef ASYNCDATABASE_H
 #define ASYNCDATABASE_H
 
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QDebug>
+#include <QElapsedTimer>
 #include <QObject>
 #include "../database.h"
+#include "removalnotifier.h"
+#include "sqlitebackup.h"
 #include "workerthread.h"
 
+namespace AsyncDatabaseDetail {
+const int defaultReaderThreadsCount = 2;
+/*
+ * Retention starts when used size exceeds high percent
+ * of maximum database size and removes oldest records
+ * until used size drops below low percent
+ */
+const int retentionHighPercent = 95;
+const int retentionLowPercent = 90;
+/*
+ * Count of records removed by one retention step,
+ * small steps let queued writes run between them
+ */
+const int retentionBatchSize = 500;
+/*
+ * Minimum period of used size checks in milliseconds,
+ * size is not queried after each write batch
+ */
+const int retentionCheckIntervalMs = 1000;
+/*
+ * Free pages are returned to file system when they are more than
+ * both minimum count and percent of database pages,
+ * so pages freed by retention are kept for next writes
+ */
+const qint64 vacuumMinFreePages = 256;
+const qint64 vacuumFreePercent = 10;
+/*
+ * Count of pages returned by one idle vacuum step
+ */
+const int vacuumStepPages = 64;
+/*
+ * Count of pages copied by one backup step
+ */
+const int defaultBackupStepPages = 256;
+
+/*
+ * Pages of partition files not reached by backup yet are not counted
+ */
+struct BackupProgress {
+    int totalPages;
+    int remainingPages;
+    /*
+     * Average copy speed since start of backup
+     */
+    qint64 bytesPerSecond;
+    bool finished;
+    bool success;
+    QString errorString;
+};
+}
+
 template <typename... T>
 class AsyncDatabase : public QObject
 {
@@ -13,11 +73,69 @@ public:
     explicit AsyncDatabase(
             const QString& databasePath,
             QObject* parent = nullptr);
+    /**
+     * @brief AsyncDatabase
+     * Database runs in WAL mode with one writer thread
+     * and pool of reader threads, each with own connection
+     * @param readerThreadsCount count of reader threads,
+     * if 0 reads are executed by writer thread
+     */
+    AsyncDatabase(
+            const QString& databasePath,
+            int readerThreadsCount,
+            QObject* parent = nullptr);
+    /**
+     * @brief AsyncDatabase
+     * @param options connection settings, reader threads
+     * do not wait for writer only with WAL journal
+     */
+    AsyncDatabase(
+            const QString& databasePath,
+            const DatabaseOptions& options,
+            int readerThreadsCount = AsyncDatabaseDetail::defaultReaderThreadsCount,
+            QObject* parent = nullptr);
+    /**
+     * @brief AsyncDatabase
+     * @param partitionPolicy if enabled, records are written
+     * to partition files, see PartitionPolicy
+     */
+    AsyncDatabase(
+            const QString& databasePath,
+            const DatabaseOptions& options,
+            const PartitionPolicy& partitionPolicy,
+            int readerThreadsCount = AsyncDatabaseDetail::defaultReaderThreadsCount,
+            QObject* parent = nullptr);
+    /**
+     * @brief AsyncDatabase
+     * @param maxDatabaseSize maximum size of database in kilobytes,
+     * enforced by background removal of oldest records
+     * only if options.enforceMaxDatabaseSize is set
+     */
+    AsyncDatabase(
+            const QString& databasePath,
+            int maxDatabaseSize,
+            const DatabaseOptions& options,
+            const PartitionPolicy& partitionPolicy = PartitionPolicy(),
+            int readerThreadsCount = AsyncDatabaseDetail::defaultReaderThreadsCount,
+            QObject* parent = nullptr);
     ~AsyncDatabase();
 
     Database<T...>* internalDatabase() const;
+
+    /**
+     * @brief internalThread
+     * @return writer thread
+     */
     WorkerThread* internalThread() const;
 
+    /**
+     * @brief readerThread
+     * @return least loaded reader thread
+     */
+    WorkerThread* readerThread() const;
+
+    int readerThreadsCount() const;
+
     template <size_t tableIndex, typename FilterType>
     void read(
             unsigned offset, unsigned count,
@@ -31,9 +149,124 @@ public:
             std::function<void(uint)> cb,
             FilterType filter = FilterType());
 
+    /**
+     * @brief readColumns
+     * Reads columns Cols on reader thread,
+     * see Database::readColumns
+     */
+    template <size_t tableIndex, size_t... Cols, typename FilterType>
+    void readColumns(
+            unsigned offset, unsigned count,
+            std::function<void(typename DatabaseDetail::ColumnsReader<
+            typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>,
+            Cols...
+            >::Columns)> cb,
+            FilterType filter = FilterType());
+
+    /**
+     * @brief backupTo
+     * Copies database to path while it is in use.
+     * With incremental backup (see SqliteBackup) copy is made by
+     * writer thread in steps queued after writes, so writes keep
+     * flowing and are included into copy. Otherwise each file is
+     * copied at once by VACUUM INTO on reader thread, which does not
+     * block writer in WAL mode; pagesPerStep is not used then.
+     * Without reader threads copy blocks writes until it is finished.
+     * Partitioned database is copied with its partition files
+     * @param pagesPerStep count of pages copied between writes
+     * @param progressCb called from thread of copy after each step
+     */
+    void backupTo(
+            const QString& path,
+            int pagesPerStep = AsyncDatabaseDetail::defaultBackupStepPages,
+            std::function<void(AsyncDatabaseDetail::BackupProgress)> progressCb
+                = nullptr);
+
+    /**
+     * @brief removalNotifier
+     * Listeners are called from writer thread after retention
+     * removed records, see DatabaseOptions::enforceMaxDatabaseSize
+     */
+    std::shared_ptr<RemovalNotifier> removalNotifier() const;
+
+    /**
+     * @brief afterWriteCommit
+     * Called from write task to publish its result only after
+     * transaction of its write batch is committed.
+     * If writes are not in transaction onCommit runs immediately.
+     * Must be called from writer thread
+     * @param onRollback runs instead of onCommit if commit fails
+     */
+    void afterWriteCommit(Task onCommit, Task onRollback);
+
+private:
+    struct Backup {
+        WorkerThread* thread;
+        std::vector<std::unique_ptr<SqliteBackup>> files;
+        size_t current = 0;
+        int pagesPerStep;
+        QElapsedTimer timer;
+        qint64 copiedBytes = 0;
+        std::function<void(AsyncDatabaseDetail::BackupProgress)> cb;
+    };
+
+    /**
+     * @brief startBackup
+     * Makes first step of copy, called from thread
+     * which makes all steps with its own connections
+     */
+    void startBackup(
+            WorkerThread* thread,
+            const QString& path,
+            int pagesPerStep,
+            std::function<void(AsyncDatabaseDetail::BackupProgress)> progressCb);
+
+    /**
+     * @brief backupStep
+     * Copies next pages and queues next step
+     * until all files are copied
+     */
+    void backupStep(std::unique_ptr<Backup> backup);
+
+    /**
+     * @brief checkRetention
+     * Starts retention if it is enabled and database is near
+     * retention size. Called from writer thread after writes,
+     * size is checked at most once per retentionCheckIntervalMs
+     */
+    void checkRetention();
+
+    /**
+     * @brief retentionStep
+     * Removes batch of oldest records and queues next step
+     * while used size is above low limit
+     */
+    void retentionStep();
+
+    /**
+     * @brief vacuumStep
+     * Returns part of excess free pages to file system.
+     * Called from writer thread when it is idle
+     * @return true if more free pages must be returned
+     */
+    bool vacuumStep();
+
 private:
     Database<T...>* _database;
     WorkerThread* _thread;
+    QVector<WorkerThread*> _readers;
+    /*
+     * Accessed only from writer thread.
+     * maxDatabaseSize if it is enforced, otherwise 0
+     */
+    const qint64 _retentionMaxSize;
+    QElapsedTimer _retentionCheckTimer;
+    bool _retentionRunning;
+    bool _retentionRemoved;
+    bool _vacuumCheckNeeded;
+    bool _inWriteBatch;
+    std::vector<std::pair<Task, Task>> _commitTasks;
+    const std::shared_ptr<RemovalNotifier> _removalNotifier;
 
 };
 
@@ -47,15 +280,109 @@ template <typename... T>
 AsyncDatabase<T...>::AsyncDatabase(
         const QString& databasePath,
         QObject* parent)
+    : AsyncDatabase(
+          databasePath,
+          AsyncDatabaseDetail::defaultReaderThreadsCount,
+          parent)
+{}
+
+template <typename... T>
+AsyncDatabase<T...>::AsyncDatabase(
+        const QString& databasePath,
+        int readerThreadsCount,
+        QObject* parent)
+    : AsyncDatabase(
+          databasePath,
+          DatabaseOptions::writeAheadLog(),
+          readerThreadsCount,
+          parent)
+{}
+
+template <typename... T>
+AsyncDatabase<T...>::AsyncDatabase(
+        const QString& databasePath,
+        const DatabaseOptions& options,
+        int readerThreadsCount,
+        QObject* parent)
+    : AsyncDatabase(
+          databasePath,
+          options,
+          PartitionPolicy(),
+          readerThreadsCount,
+          parent)
+{}
+
+template <typename... T>
+AsyncDatabase<T...>::AsyncDatabase(
+        const QString& databasePath,
+        const DatabaseOptions& options,
+        const PartitionPolicy& partitionPolicy,
+        int readerThreadsCount,
+        QObject* parent)
+    : AsyncDatabase(
+          databasePath,
+          DatabaseDetail::defaultMaxDatabaseSize,
+          options,
+          partitionPolicy,
+          readerThreadsCount,
+          parent)
+{}
+
+template <typename... T>
+AsyncDatabase<T...>::AsyncDatabase(
+        const QString& databasePath,
+        int maxDatabaseSize,
+        const DatabaseOptions& options,
+        const PartitionPolicy& partitionPolicy,
+        int readerThreadsCount,
+        QObject* parent)
     : QObject(parent)
-    , _database{ new Database<T...>(databasePath)}
+    , _database{ new Database<T...>(
+                     databasePath,
+                     maxDatabaseSize,
+                     options,
+                     partitionPolicy)}
     , _thread{ new WorkerThread() }
+    , _readers()
+    , _retentionMaxSize{ options.enforceMaxDatabaseSize ? qint64(maxDatabaseSize) : 0 }
+    , _retentionCheckTimer()
+    , _retentionRunning{ false }
+    , _retentionRemoved{ false }
+    , _vacuumCheckNeeded{ true }
+    , _inWriteBatch{ false }
+    , _commitTasks()
+    , _removalNotifier{ std::make_shared<RemovalNotifier>() }
 {
-//    _database->move
+    Q_ASSERT(readerThreadsCount >= 0);
+    for (auto i = 0; i < readerThreadsCount; ++i) {
+        _readers.append(new WorkerThread());
+    }
+    // Writes drained together are commited in one transaction
+    _thread->setWriteBatchHook([this](const std::function<void()>& writes) {
+        const bool transaction = _database->beginTransaction();
+        _inWriteBatch = transaction;
+        writes();
+        _inWriteBatch = false;
+        const bool committed = !transaction || _database->commitTransaction();
+        auto commitTasks = std::move(_commitTasks);
+        _commitTasks.clear();
+        for (auto& tasks : commitTasks) {
+            if (committed) {
+                tasks.first();
+            }
+            else if (tasks.second) {
+                tasks.second();
+            }
+        }
+        _vacuumCheckNeeded = true;
+        checkRetention();
+    });
+    _thread->setIdleHook([this]() { return vacuumStep(); });
 }
 
 template <typename... T>
 AsyncDatabase<T...>::~AsyncDatabase() {
+    qDeleteAll(_readers);
     delete _thread;
 //    dbg << "thread deleted";
     delete _database;
@@ -71,6 +398,28 @@ WorkerThread* AsyncDatabase<T...>::internalThread() const {
     return _thread;
 }
 
+template<typename... T>
+WorkerThread* AsyncDatabase<T...>::readerThread() const {
+    if (_readers.isEmpty()) {
+        return _thread;
+    }
+    auto reader = _readers.first();
+    auto depth = reader->statistics().depth;
+    for (auto i = 1; i < _readers.size() && depth != 0; ++i) {
+        const auto readerDepth = _readers.at(i)->statistics().depth;
+        if (readerDepth < depth) {
+            reader = _readers.at(i);
+            depth = readerDepth;
+        }
+    }
+    return reader;
+}
+
+template<typename... T>
+int AsyncDatabase<T...>::readerThreadsCount() const {
+    return _readers.size();
+}
+
 template <typename... T>
 template <size_t tableIndex, typename FilterType>
 void AsyncDatabase<T...>::read(
@@ -83,9 +432,9 @@ void AsyncDatabase<T...>::read(
     auto task = [this, offset, count, filter, cb](){
         auto res = _database-> template read<tableIndex>(
                     offset, count, filter);
-        cb(res);
+        cb(std::move(res));
     };
-    _thread->work(task);
+    readerThread()->work(std::move(task));
 }
 
 template <typename... T>
@@ -95,10 +444,194 @@ void AsyncDatabase<T...>::numberOfRecords(
         FilterType filter)
 {
     auto task = [this,filter, cb](){
-        uint res = _database->numberOfRecords<tableIndex>(filter);
-//        uint res = _database->template numberOfRecords<tableIndex>(filter);
+        uint res = _database->template numberOfRecords<tableIndex>(filter);
         cb(res);
     };
+    readerThread()->work(std::move(task));
+}
+
+template <typename... T>
+template <size_t tableIndex, size_t... Cols, typename FilterType>
+void AsyncDatabase<T...>::readColumns(
+        unsigned offset, unsigned count,
+        std::function<void(typename DatabaseDetail::ColumnsReader<
+        typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>,
+        Cols...
+        >::Columns)> cb,
+        FilterType filter)
+{
+    auto task = [this, offset, count, filter, cb]() {
+        auto res = _database->template readColumns<tableIndex, Cols...>(
+                    offset, count, filter);
+        cb(std::move(res));
+    };
+    readerThread()->work(std::move(task));
+}
+
+template <typename... T>
+void AsyncDatabase<T...>::backupTo(
+        const QString& path,
+        int pagesPerStep,
+        std::function<void(AsyncDatabaseDetail::BackupProgress)> progressCb)
+{
+    Q_ASSERT(pagesPerStep > 0 || pagesPerStep == -1);
+    auto task = [this, path, pagesPerStep, progressCb]() {
+        // Writer connection is used, so writes between steps
+        // do not restart copy
+        if (SqliteBackup::isIncremental(_database->connection())) {
+            startBackup(_thread, path, pagesPerStep, progressCb);
+            return;
+        }
+        // Copy at once reads snapshot of WAL database
+        // while writer goes on
+        auto reader = readerThread();
+        reader->work([this, reader, path, progressCb]() {
+            startBackup(reader, path, -1, progressCb);
+        });
+    };
+    _thread->work(std::move(task));
+}
+
+template <typename... T>
+std::shared_ptr<RemovalNotifier> AsyncDatabase<T...>::removalNotifier() const {
+    return _removalNotifier;
+}
+
+template <typename... T>
+void AsyncDatabase<T...>::afterWriteCommit(Task onCommit, Task onRollback) {
+    Q_ASSERT(QThread::currentThread() == _thread);
+    if (!_inWriteBatch) {
+        onCommit();
+        return;
+    }
+    _commitTasks.emplace_back(std::move(onCommit), std::move(onRollback));
+}
+
+/* ******************************************************************
+ * Private
+ * ******************************************************************
+ */
+
+template <typename... T>
+void AsyncDatabase<T...>::startBackup(
+        WorkerThread* thread,
+        const QString& path,
+        int pagesPerStep,
+        std::function<void(AsyncDatabaseDetail::BackupProgress)> progressCb)
+{
+    std::unique_ptr<Backup> backup(new Backup);
+    backup->thread = thread;
+    for (const auto& source : _database->backupSources(path)) {
+        backup->files.emplace_back(
+                    new SqliteBackup(source.first, source.second));
+    }
+    backup->pagesPerStep = pagesPerStep;
+    backup->cb = progressCb;
+    backup->timer.start();
+    backupStep(std::move(backup));
+}
+
+template <typename... T>
+void AsyncDatabase<T...>::backupStep(std::unique_ptr<Backup> backup) {
+    auto& file = *backup->files.at(backup->current);
+    file.step(backup->pagesPerStep);
+
+    AsyncDatabaseDetail::BackupProgress progress;
+    progress.totalPages = 0;
+    progress.remainingPages = 0;
+    qint64 copiedBytes = backup->copiedBytes;
+    for (const auto& f : backup->files) {
+        progress.totalPages += f->totalPages();
+        progress.remainingPages += f->isFinished() ? 0 : f->remainingPages();
+    }
+    copiedBytes += file.copiedBytes();
+    const auto elapsed = backup->timer.elapsed();
+    progress.bytesPerSecond = elapsed > 0 ? copiedBytes * 1000 / elapsed : 0;
+    progress.success = !file.isFinished() || file.isSuccess();
+    progress.errorString = file.errorString();
+
+    if (file.isFinished() && file.isSuccess()) {
+        backup->copiedBytes = copiedBytes;
+        ++backup->current;
+    }
+    progress.finished = !progress.success
+            || backup->current == backup->files.size();
+    if (!progress.success) {
+        qDebug() << "backup failed" << progress.errorString;
+    }
+    if (backup->cb) {
+        backup->cb(progress);
+    }
+    if (!progress.finished) {
+        // Queued writes run before next step
+        auto thread = backup->thread;
+        thread->work([this, b = std::move(backup)]() mutable {
+            backupStep(std::move(b));
+        });
+    }
+}
+
+template <typename... T>
+void AsyncDatabase<T...>::checkRetention() {
+    if (_retentionRunning || _retentionMaxSize <= 0) {
+        return;
+    }
+    if (_retentionCheckTimer.isValid()
+            && _retentionCheckTimer.elapsed()
+                < AsyncDatabaseDetail::retentionCheckIntervalMs) {
+        return;
+    }
+    _retentionCheckTimer.start();
+    const auto usedSize = _database->usedSize();
+    if (usedSize * 100 <= _retentionMaxSize * AsyncDatabaseDetail::retentionHighPercent) {
+        return;
+    }
+    _retentionRunning = true;
+    _thread->work([this]() { retentionStep(); });
+}
+
+template <typename... T>
+void AsyncDatabase<T...>::retentionStep() {
+    const auto removed = _database->removeOldestRecords(
+                AsyncDatabaseDetail::retentionBatchSize);
+    const auto usedSize = _database->usedSize();
+    _retentionRemoved |= removed > 0;
+    if (removed > 0
+            && usedSize * 100 > _retentionMaxSize * AsyncDatabaseDetail::retentionLowPercent) {
+        _thread->work([this]() { retentionStep(); });
+    }
+    else {
+        _retentionRunning = false;
+        if (_retentionRemoved) {
+            _retentionRemoved = false;
+            // Views drop cached records once per retention pass
+            _removalNotifier->notify();
+        }
+    }
+    _vacuumCheckNeeded = true;
+}
+
+template <typename... T>
+bool AsyncDatabase<T...>::vacuumStep() {
+    // Pages freed by running retention are reused by next writes
+    if (!_vacuumCheckNeeded || _retentionRunning) {
+        return false;
+    }
+    const auto freePages = _database->freePagesCount();
+    const auto threshold = qMax(
+                AsyncDatabaseDetail::vacuumMinFreePages,
+                _database->pagesCount() * AsyncDatabaseDetail::vacuumFreePercent / 100);
+    if (freePages <= threshold
+            || !_database->incrementalVacuum(AsyncDatabaseDetail::vacuumStepPages)) {
+        _vacuumCheckNeeded = false;
+        return false;
+    }
+    // Nothing is returned if database has not incremental auto vacuum
+    if (_database->freePagesCount() >= freePages) {
+        _vacuumCheckNeeded = false;
+        return false;
+    }
+    return true;
 }
 
 #endif // ASYNCDATABASE_H
@@ -0,0 +1,78 @@
+#include "connectioncache.h"
+
+#include <atomic>
+#include <memory>
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+
+namespace {
+
+/*
+ * Cache of one thread, mutex is locked by other threads
+ * only when instance is destroyed
+ */
+struct ThreadConnections {
+    QMutex mutex;
+    QHash<quint64, QSqlDatabase> connections;
+};
+
+QMutex registryMutex;
+QSet<ThreadConnections*> registry;
+
+/*
+ * Registers cache of thread on first use, unregisters on thread exit
+ */
+struct ThreadConnectionsHolder {
+    ThreadConnectionsHolder()
+        : cache{ std::make_unique<ThreadConnections>() }
+    {
+        QMutexLocker l(&registryMutex);
+        registry.insert(cache.get());
+    }
+    ~ThreadConnectionsHolder() {
+        QMutexLocker l(&registryMutex);
+        registry.remove(cache.get());
+    }
+
+    std::unique_ptr<ThreadConnections> cache;
+};
+
+ThreadConnections& threadConnections() {
+    thread_local ThreadConnectionsHolder holder;
+    return *holder.cache;
+}
+
+std::atomic<quint64> lastInstanceId{ 0 };
+
+} // namespace
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+quint64 ConnectionCache::nextInstanceId() {
+    return ++lastInstanceId;
+}
+
+QSqlDatabase ConnectionCache::find(quint64 instanceId) {
+    auto& cache = threadConnections();
+    QMutexLocker l(&cache.mutex);
+    return cache.connections.value(instanceId);
+}
+
+void ConnectionCache::insert(quint64 instanceId, const QSqlDatabase& db) {
+    auto& cache = threadConnections();
+    QMutexLocker l(&cache.mutex);
+    cache.connections.insert(instanceId, db);
+}
+
+void ConnectionCache::remove(quint64 instanceId) {
+    QMutexLocker l(&registryMutex);
+    for (auto cache : qAsConst(registry)) {
+        QMutexLocker cacheLocker(&cache->mutex);
+        cache->connections.remove(instanceId);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef CONNECTIONCACHE_H
+#define CONNECTIONCACHE_H
+
+#include <QSqlDatabase>
+
+/**
+ * @brief The ConnectionCache class
+ * Thread-local connections of Database instances keyed by instance id,
+ * so lookup of connection does not build its name and does not take
+ * global lock of QSqlDatabase. Ids are never reused.
+ * This class is thread-safe, each thread has its own cache
+ */
+class ConnectionCache
+{
+public:
+    /**
+     * @brief nextInstanceId
+     * @return unique id of new Database instance
+     */
+    static quint64 nextInstanceId();
+
+    /**
+     * @brief find
+     * @return connection of instance in current thread,
+     * invalid connection if it was not cached
+     */
+    static QSqlDatabase find(quint64 instanceId);
+
+    /**
+     * @brief insert
+     * Caches connection of instance for current thread
+     */
+    static void insert(quint64 instanceId, const QSqlDatabase& db);
+
+    /**
+     * @brief remove
+     * Drops connections of instance from caches of all threads,
+     * must be called before QSqlDatabase::removeDatabase()
+     */
+    static void remove(quint64 instanceId);
+
+};
+
+#endif // CONNECTIONCACHE_H
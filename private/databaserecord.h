@@ -24,7 +24,7 @@ struct DatabaseRecord : public T {
         , rowId{id}
     {}
 
-    bool operator ==(const DatabaseRecord<T>& other) {
+    bool operator ==(const DatabaseRecord<T>& other) const {
         return rowId == other.rowId;
     }
 
@@ -1,12 +1,19 @@
 #ifndef DATABASETABLEVIEWMODEL_H
 #define DATABASETABLEVIEWMODEL_H
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include <QQueue>
 #include <QThread>
+#include <QElapsedTimer>
 
 #include "taskedlistmodel.h"
 #include "databaseviewmodeldetail.h"
-#include "databaseviewmodeldetail_vector.h"
+#include "databaseviewmodeldetail_deque.h"
+#include "pagesizer.h"
 
 #include "QtStructDatabase/QtTupleConversions/typelist.h"
 
@@ -37,6 +44,9 @@ protected:
             );
     void setDatabase(AsyncDatabase<T...>* database, QStringList roles);
 
+public:
+    ~DatabaseTableViewModel() override;
+
 private:
     void init(QStringList roles);
 
@@ -47,7 +57,13 @@ public:
     bool canFetchMore(const QModelIndex& parent) const override final;
     void fetchMore(const QModelIndex& parent) override final;
 
-    void addRecord(const typename Conversions::TypeAt<
+    /**
+     * @brief addRecord
+     * Queues write of record to worker thread
+     * @return false if write queue of database is full
+     * and record was not queued
+     */
+    bool addRecord(const typename Conversions::TypeAt<
                    Conversions::TypeList<T...>, tableIndex
                    >::Type& data);
 
@@ -70,6 +86,40 @@ public:
     //void setDatabase(Database<T...>* database);
     void setFilter(FilterType filter);
 
+    /**
+     * @brief reload
+     * Reads records from database again,
+     * e.g. after records were removed by retention
+     */
+    void reload();
+
+    /**
+     * @brief setPageSize
+     * Sets fixed count of records fetched at once
+     */
+    void setPageSize(uint pageSize);
+
+    /**
+     * @brief setAdaptivePageSize
+     * Enables page size adjustment after each fetch
+     * to keep one read near targetLatencyMs
+     */
+    void setAdaptivePageSize(
+            bool adaptive,
+            uint targetLatencyMs = DatabaseViewModelDetail::targetFetchLatencyMs);
+
+    /**
+     * @brief pageSize
+     * @return count of records fetched at once now
+     */
+    uint pageSize() const;
+
+    /**
+     * @brief pageSizer
+     * @return page size statistics for diagnostics
+     */
+    const PageSizer& pageSizer() const;
+
 protected:
     QVariantList rowData(uint rowIndex) const;
 
@@ -81,6 +131,12 @@ private:
 
 private:
     void initialFillModel();
+    /**
+     * @brief scheduleReload
+     * Queues reload() unless it is already queued.
+     * This method is thread-safe
+     */
+    void scheduleReload();
     WriteToDatabaseResult<
         typename Conversions::TypeAt<
             Conversions::TypeList<T...>, tableIndex
@@ -91,13 +147,14 @@ private:
                 data);
 private:
     AsyncDatabase<T...>* _database;
-    DatabaseViewModelDetail::Vector<
+    DatabaseViewModelDetail::Deque<
         DatabaseRecord<
         typename Conversions::TypeAt<
             Conversions::TypeList<T...>, tableIndex
-            >::Type>,
-        100u> _data;
+            >::Type>
+        > _data;
     FilterType _filter;
+    PageSizer _pageSizer;
 
     QHash<int, QByteArray> _roleNames;
 
@@ -112,6 +169,13 @@ private:
 
     bool _canFetchMore;
     bool _nowFetch;
+    /*
+     * Set by writer thread when records of this model were
+     * rolled back or removed, view is reloaded once for them
+     */
+    std::atomic<bool> _reloadScheduled;
+    std::shared_ptr<RemovalNotifier> _removalNotifier;
+    int _removalListener;
 
 };
 
@@ -126,10 +190,14 @@ DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::DatabaseTableVie
     , _database{ database }
     , _data{}
     , _filter()
+    , _pageSizer()
     , _row{ 0, {} }
     , _reversed{ DatabaseViewModelDetail::Direction::Reversed == direction }
     , _canFetchMore{ false }
     , _nowFetch{ false }
+    , _reloadScheduled{ false }
+    , _removalNotifier()
+    , _removalListener{ -1 }
 {
     init(roles);
 }
@@ -143,12 +211,24 @@ DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::DatabaseTableVie
     , _database{ nullptr }
     , _data{}
     , _filter()
+    , _pageSizer()
     , _row{ 0, {} }
     , _reversed{ reversed }
     , _canFetchMore{ false }
     , _nowFetch{ false }
+    , _reloadScheduled{ false }
+    , _removalNotifier()
+    , _removalListener{ -1 }
 {}
 
+template<size_t tableIndex, typename FilterType, typename... T>
+DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::~DatabaseTableViewModel() {
+    // Database may be destroyed already, notifier is shared
+    if (_removalNotifier) {
+        _removalNotifier->removeListener(_removalListener);
+    }
+}
+
 template<size_t tableIndex, typename FilterType, typename... T>
 void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::setDatabase(
         AsyncDatabase<T...>* database,
@@ -176,6 +256,9 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::init(
     for (auto i = 0; i < allRoles.size(); ++i) {
         _roleNames.insert(Qt::UserRole + i + 1, allRoles.at(i).toLocal8Bit());
     }
+    // Records removed by retention of database are dropped from view
+    _removalNotifier = _database->removalNotifier();
+    _removalListener = _removalNotifier->addListener([this]() { scheduleReload(); });
     initialFillModel();
 }
 
@@ -228,24 +311,38 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::fetchMore(
 
     const auto currentDataCount = _data.size();
 
-    auto guiCb = [this, currentDataCount](VectorType res, bool canFetchMore) {
+    auto guiCb = [this](VectorType&& res, bool canFetchMore) {
         Q_ASSERT(this->thread() == QThread::currentThread());
+        // Page is read by reader thread concurrently with writes,
+        // records added to view by writer meanwhile are skipped
+        if (!_data.isEmpty()) {
+            const auto lastRowId = _data.last().rowId;
+            const bool reversed = _reversed;
+            auto isShown = [lastRowId, reversed](const DatabaseRecord<StoredType>& r) {
+                return reversed ? r.rowId >= lastRowId : r.rowId <= lastRowId;
+            };
+            res.erase(std::remove_if(res.begin(), res.end(), isShown), res.end());
+        }
+        _nowFetch = false;
+        _canFetchMore = canFetchMore;
+        if (res.isEmpty()) {
+            return;
+        }
+        const int first = int(_data.size());
         beginInsertRows(
                     QModelIndex(),
-                    currentDataCount,
-                    currentDataCount + res.length() - 1
+                    first,
+                    first + res.length() - 1
                     );
         dbg << "insert rows from"
-            << currentDataCount
+            << first
             << "to"
-            << currentDataCount + res.length() - 1
+            << first + res.length() - 1
             << "current data size"
             << _data.size() << "|" << AS_KV(tableIndex);
-        _data.append(res);
+        _data.append(std::move(res));
         dbg << "new data size" << _data.size() << "|" << AS_KV(tableIndex);
         endInsertRows();
-        _nowFetch = false;
-        _canFetchMore = canFetchMore;
     };
 
     const auto filter = _filter;
@@ -253,25 +350,39 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::fetchMore(
 
     auto dbTask = [this, db, guiCb, filter, currentDataCount]() {
         const auto recordCount = db->template numberOfRecords<tableIndex>(filter);
+        if (recordCount <= currentDataCount) {
+            auto guiTask = [guiCb]() {
+                guiCb(VectorType(), false);
+            };
+            addGuiTask(std::move(guiTask));
+            return;
+        }
         auto countToFetch = std::min(
                     recordCount - currentDataCount,
-                    DatabaseViewModelDetail::sizeToFetch);
-        Q_ASSERT(countToFetch > 0);
+                    _pageSizer.pageSize());
         bool canFetchMore = recordCount > countToFetch + currentDataCount;
-        auto fetchedData = db->template read<tableIndex>(currentDataCount, countToFetch, _filter);
+        // Reversed view shows newest records first,
+        // so next page is older records before shown ones
+        const auto offset = _reversed
+                ? recordCount - currentDataCount - countToFetch
+                : currentDataCount;
+        QElapsedTimer readTimer;
+        readTimer.start();
+        auto fetchedData = db->template read<tableIndex>(offset, countToFetch, filter);
+        _pageSizer.reportFetch(uint(fetchedData.size()), readTimer.nsecsElapsed());
         if (_reversed) {
             std::reverse(fetchedData.begin(), fetchedData.end());
         }
-        auto guiTask = [fetchedData, guiCb, canFetchMore]() {
-            guiCb(fetchedData, canFetchMore);
+        auto guiTask = [fetchedData = std::move(fetchedData), guiCb, canFetchMore]() mutable {
+            guiCb(std::move(fetchedData), canFetchMore);
         };
-        addGuiTask(guiTask);
+        addGuiTask(std::move(guiTask));
     };
 
     _nowFetch = true;
     dbg << "add need fetch more task" << "|" << AS_KV(tableIndex);
-    auto th = _database->internalThread();
-    th->work(dbTask);
+    auto th = _database->readerThread();
+    th->work(std::move(dbTask));
 }
 
 /* ******************************************************************
@@ -286,7 +397,9 @@ template <typename Tuple, size_t...Is>
 QVariantList tupleToVariantList(Tuple/*&&*/ t, std::index_sequence<Is...>) {
     QVariantList vl;
     ((
-    vl.append(QVariant(std::get<Is>(t)))
+    vl.append(ColumnTraits<
+              std::decay_t<std::tuple_element_t<Is, Tuple>>
+              >::toDisplay(std::get<Is>(t)))
     ), ...);
     return vl;
 }
@@ -324,7 +437,7 @@ DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::rowData(
 
 
 template <size_t tableIndex, typename FilterType, typename... T>
-void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::addRecord(
+bool DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::addRecord(
         const typename Conversions::TypeAt<
             Conversions::TypeList<T...>, tableIndex>::Type&
             data
@@ -335,24 +448,26 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::addRecord(
     typename Conversions::TypeAt<
         Conversions::TypeList<T...>, tableIndex
     >::Type>;
-    auto guiCb = [this, filterPassed](DbRec r) {
+    auto guiCb = [this, filterPassed](DbRec&& r, qint64 previousRowId) {
         Q_ASSERT(this->thread() == QThread::currentThread());
+        // Row ids of partitioned database jump at new partition,
+        // so last shown record is compared with previous one
         const bool needUpdateView = filterPassed
-                && (_reversed || _data.isEmpty() || (_data.last().rowId + 1u == r.rowId));
+                && (_reversed || _data.isEmpty() || _data.last().rowId == previousRowId);
         if (!needUpdateView) {
             return;
         }
-        const int index = _reversed ? 0 : _data.length();
+        const int index = _reversed ? 0 : int(_data.size());
         beginInsertRows(QModelIndex(), index, index);
 //        qDebug() << "add record at index" << index
 //            << "table" << tableIndex
 //            << "rowId:" << maxRowId
 //            << AS_KV(data);
         if (!_reversed) {
-            _data.append(r);
+            _data.append(std::move(r));
         }
         else {
-            _data.prepend(r); // Fast prepending vector
+            _data.prepend(std::move(r));
             _row.row++;
         }
         endInsertRows();
@@ -361,22 +476,27 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::addRecord(
     };
     auto db = _database->internalDatabase();
     auto dbTask = [this, db, guiCb, data]() {
+        const auto previousRowId = db->template maxRowId<tableIndex>();
         const bool success = db->template addRecord<tableIndex>(data);
         const auto maxRowId = db->template maxRowId<tableIndex>();
-        const DbRec r(maxRowId, data);
-        auto task = [guiCb, r]() {
-            guiCb(r);
+        DbRec r(maxRowId, data);
+        auto task = [guiCb, r = std::move(r), previousRowId]() mutable {
+            guiCb(std::move(r), previousRowId);
         };
-        if (success) {
-            addGuiTask(task);
-        }
-        else {
+        if (!success) {
             dbg << "ERROR: write record failed";
+            return;
         }
+        // Record is shown only if its transaction is committed
+        _database->afterWriteCommit(
+                    [this, task = std::move(task)]() mutable {
+            addGuiTask(std::move(task));
+        },
+                    [this]() { scheduleReload(); });
     };
     dbg << "begin add record" << "|" << AS_KV(tableIndex);
     auto th = _database->internalThread();
-    th->work(dbTask);
+    return th->work(std::move(dbTask), WorkerThread::TaskType::Write);
 }
 
 template <size_t tableIndex, typename FilterType, typename... T>
@@ -396,6 +516,54 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::setFilter(
     }
 }
 
+template <size_t tableIndex, typename FilterType, typename... T>
+void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::reload()
+{
+    Q_ASSERT(this->thread() == QThread::currentThread());
+    dbg << "reload" << "|" << AS_KV(tableIndex);
+    initialFillModel();
+}
+
+template <size_t tableIndex, typename FilterType, typename... T>
+void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::scheduleReload()
+{
+    if (_reloadScheduled.exchange(true)) {
+        return;
+    }
+    addGuiTask([this]() {
+        _reloadScheduled = false;
+        reload();
+    });
+}
+
+template <size_t tableIndex, typename FilterType, typename... T>
+void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::setPageSize(
+        uint pageSize)
+{
+    _pageSizer.setPageSize(pageSize);
+}
+
+template <size_t tableIndex, typename FilterType, typename... T>
+void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::setAdaptivePageSize(
+        bool adaptive,
+        uint targetLatencyMs)
+{
+    _pageSizer.setAdaptive(adaptive, targetLatencyMs);
+}
+
+template <size_t tableIndex, typename FilterType, typename... T>
+uint DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::pageSize() const
+{
+    return _pageSizer.pageSize();
+}
+
+template <size_t tableIndex, typename FilterType, typename... T>
+const PageSizer&
+DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::pageSizer() const
+{
+    return _pageSizer;
+}
+
 template<size_t tableIndex, typename FilterType, typename... T>
 DatabaseRecord<typename Conversions::TypeAt<Conversions::TypeList<T...>, tableIndex>::Type>
 DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::recordAt(
@@ -445,10 +613,10 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::updateRecor
     };
 
     auto db = _database->internalDatabase();
-    auto dbTask = [this, db, guiCb, record]() {
+    auto dbTask = [this, db, guiCb = std::move(guiCb), record]() mutable {
         const bool success = db->updateRecord(record);
         if (success) {
-            addGuiTask(guiCb);
+            addGuiTask(std::move(guiCb));
         }
         else {
             dbg << "updating record success";
@@ -456,7 +624,7 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::updateRecor
     };
 
     auto th = _database->internalThread();
-    th->work(dbTask);
+    th->work(std::move(dbTask));
 }
 
 
@@ -472,19 +640,46 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::initialFill
         Q_ASSERT(false);
         return;
     }
-    _data.clear();
-    if (_reversed) {
-        _data.reserveSpace();
+    if (!_data.isEmpty()) {
+        beginResetModel();
+        _data.clear();
+        _canFetchMore = false;
+        endResetModel();
     }
 
     using StoredType = typename Conversions::TypeAtT<Conversions::TypeList<T...>, tableIndex>;
     using VectorType = QVector<DatabaseRecord<StoredType>>;
 
-    auto guiCb = [this](VectorType res, bool canFetchMore) {
+    auto guiCb = [this](VectorType&& res, bool canFetchMore) {
         Q_ASSERT(this->thread() == QThread::currentThread());
         beginResetModel();
 
-        _data.append(res);
+        // Records added by writer while first page was read
+        std::vector<DatabaseRecord<StoredType>> added;
+        added.reserve(_data.size());
+        for (auto i = 0u; i < _data.size(); ++i) {
+            added.push_back(std::move(_data[int(i)]));
+        }
+        _data.clear();
+
+        const auto fetchedCount = res.size();
+        _data.append(std::move(res));
+        if (_reversed) {
+            // Newest records first, added ones are newer than page
+            for (auto it = added.rbegin(); it != added.rend(); ++it) {
+                if (_data.isEmpty() || it->rowId > _data.at(0u).rowId) {
+                    _data.prepend(std::move(*it));
+                }
+            }
+        }
+        else if (!canFetchMore) {
+            // Otherwise added records will be fetched with next pages
+            for (auto& r : added) {
+                if (_data.isEmpty() || r.rowId > _data.last().rowId) {
+                    _data.append(std::move(r));
+                }
+            }
+        }
         if (!_data.isEmpty()) {
             _row.row = 0u;
             _row.columns = DatabaseTableViewModelDetail::structToVariantList(
@@ -496,7 +691,7 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::initialFill
         endResetModel();
 
         dbg << "initial fill model finished"
-            << "count" << _data.size() << res.size() << "|" << AS_KV(tableIndex);
+            << "count" << _data.size() << fetchedCount << "|" << AS_KV(tableIndex);
 
     };
 
@@ -507,7 +702,7 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::initialFill
         auto recordCount = db->template numberOfRecords<tableIndex>(filter);
         uint countToRead = std::min(
                     recordCount,
-                    DatabaseViewModelDetail::sizeToFetch
+                    _pageSizer.pageSize()
                     );
         if (countToRead == 0) {
             auto guiClearCb = [this]() {
@@ -517,14 +712,13 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::initialFill
                 endResetModel();
                 dbg << "initial table" << tableIndex << "cleared";
             };
-            auto guiTask = [guiClearCb]() {
-                guiClearCb();
-            };
-            addGuiTask(guiTask);
+            addGuiTask(std::move(guiClearCb));
             return;
         }
         bool canFetchMore = recordCount > countToRead;
         VectorType res;
+        QElapsedTimer readTimer;
+        readTimer.start();
         if (Q_LIKELY(!_reversed)) {
             res = db->template read<tableIndex>(
                         0u, countToRead, filter);
@@ -536,16 +730,17 @@ void DatabaseTableViewModel<Database<T...>, tableIndex, FilterType>::initialFill
                         filter);
             std::reverse(res.begin(), res.end());
         }
-        auto guiTask = [res, guiCb, canFetchMore]() {
-            guiCb(res, canFetchMore);
+        _pageSizer.reportFetch(uint(res.size()), readTimer.nsecsElapsed());
+        auto guiTask = [res = std::move(res), guiCb, canFetchMore]() mutable {
+            guiCb(std::move(res), canFetchMore);
         };
-        addGuiTask(guiTask);
+        addGuiTask(std::move(guiTask));
     };
 
     dbg << "begin initial fill model" << "|" << AS_KV(tableIndex);
     _nowFetch = false;
-    auto th = _database->internalThread();
-    th->work(dbTask);
+    auto th = _database->readerThread();
+    th->work(std::move(dbTask));
 }
 
 
@@ -3,9 +3,15 @@
 
 
 namespace DatabaseViewModelDetail {
-const unsigned reservedDataSize = 100u;
 const unsigned sizeToFetch = 100u;
 
+/*
+ * Bounds and latency budget for adaptive page size
+ */
+const unsigned minSizeToFetch = 20u;
+const unsigned maxSizeToFetch = 5000u;
+const unsigned targetFetchLatencyMs = 8u;
+
 enum class Direction {
     Reversed,
     NonReversed
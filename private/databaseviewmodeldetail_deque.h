@@ -0,0 +1,154 @@
+#ifndef DATABASEVIEWMODELDETAIL_DEQUE_H
+#define DATABASEVIEWMODELDETAIL_DEQUE_H
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <QVector>
+
+namespace DatabaseViewModelDetail {
+
+/**
+ * @brief The Deque class
+ * Chunked storage with amortized O(1) prepend and append.
+ * Records are stored in fixed size chunks, only chunk pointers
+ * are moved when storage grows, records are never copied.
+ * References to stored records stay valid until clear().
+ */
+template <typename Data, uint chunkSize = 128u>
+class Deque {
+public:
+    uint size() const {
+        return _size;
+    }
+
+    bool isEmpty() const {
+        return _size == 0u;
+    }
+
+    const Data& at(uint i) const {
+        Q_ASSERT(i < _size);
+        return slot(_begin + i);
+    }
+
+    Data& operator[](int i) {
+        Q_ASSERT(uint(i) < _size);
+        return slot(_begin + uint(i));
+    }
+
+    const Data& operator[](int i) const {
+        Q_ASSERT(uint(i) < _size);
+        return slot(_begin + uint(i));
+    }
+
+    const Data& last() const {
+        return at(_size - 1u);
+    }
+
+    int indexOf(const Data& t, int from = 0) const {
+        for (auto i = uint(from); i < _size; ++i) {
+            if (at(i) == t) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
+    void clear() {
+        _chunks.clear();
+        _begin = 0u;
+        _size = 0u;
+    }
+
+    void prepend(const Data& t) {
+        reserveFront();
+        --_begin;
+        slot(_begin) = t;
+        ++_size;
+    }
+
+    void prepend(Data&& t) {
+        reserveFront();
+        --_begin;
+        slot(_begin) = std::move(t);
+        ++_size;
+    }
+
+    void append(const Data& t) {
+        reserveBack();
+        slot(_begin + _size) = t;
+        ++_size;
+    }
+
+    void append(Data&& t) {
+        reserveBack();
+        slot(_begin + _size) = std::move(t);
+        ++_size;
+    }
+
+    void append(const QVector<Data>& v) {
+        for (const auto& t : v) {
+            append(t);
+        }
+    }
+
+    void append(QVector<Data>&& v) {
+        for (auto& t : v) {
+            append(std::move(t));
+        }
+        v.clear();
+    }
+
+private:
+    using Chunk = std::unique_ptr<Data[]>;
+
+    Data& slot(uint position) {
+        return _chunks[position / chunkSize][position % chunkSize];
+    }
+
+    const Data& slot(uint position) const {
+        return _chunks[position / chunkSize][position % chunkSize];
+    }
+
+    uint capacity() const {
+        return uint(_chunks.size()) * chunkSize;
+    }
+
+    /*
+     * Adds as many chunks before first record as already allocated,
+     * so prepending stays amortized O(1)
+     */
+    void reserveFront() {
+        if (_begin != 0u) {
+            return;
+        }
+        const auto added = std::max<size_t>(1u, _chunks.size());
+        std::vector<Chunk> chunks;
+        chunks.reserve(added + _chunks.size());
+        for (size_t i = 0u; i < added; ++i) {
+            chunks.emplace_back(new Data[chunkSize]);
+        }
+        for (auto& chunk : _chunks) {
+            chunks.push_back(std::move(chunk));
+        }
+        _chunks.swap(chunks);
+        _begin = uint(added) * chunkSize;
+    }
+
+    void reserveBack() {
+        if (_begin + _size == capacity()) {
+            _chunks.emplace_back(new Data[chunkSize]);
+        }
+    }
+
+private:
+    std::vector<Chunk> _chunks;
+    uint _begin = 0u;
+    uint _size = 0u;
+
+};
+
+} // namespace DatabaseViewModelDetail
+
+#endif // DATABASEVIEWMODELDETAIL_DEQUE_H
@@ -3,6 +3,9 @@
 
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+
+#include "../timestamp.h"
 
 namespace EventDatabaseDetail {
 
@@ -13,6 +16,60 @@ struct Activation {
     bool shutdownCorrect;
 };
 
+/**
+ * @brief The RetentionPolicy struct
+ * Limits of stored activations, 0 disables limit.
+ * Oldest activations are removed with their events
+ * while any limit is exceeded, current activation is never removed
+ */
+struct RetentionPolicy {
+    /*
+     * Maximum time since activation end in seconds
+     */
+    qint64 maxAge = 0;
+    int maxActivations = 0;
+    qint64 maxEvents = 0;
+    /*
+     * Period of limits check in milliseconds
+     */
+    int checkInterval = 600000;
+};
+
+/*
+ * Count of events removed in one background transaction
+ */
+const uint retentionBatchSize = 1000u;
+
+/**
+ * @brief The EventClock class
+ * Cheap clock of event times: monotonic timer anchored to UTC
+ * time of activation start, no time zone conversion per event.
+ * Wall clock adjustments during activation are not followed.
+ * now() is thread-safe after construction
+ */
+class EventClock
+{
+public:
+    explicit EventClock(qint64 epochOffset)
+        : _epochOffset{ epochOffset }
+    {
+        _timer.start();
+    }
+
+    qint64 epochOffset() const {
+        return _epochOffset;
+    }
+
+    Timestamp now() const {
+        return Timestamp(_epochOffset + _timer.elapsed());
+    }
+
+private:
+    qint64 _epochOffset;
+    QElapsedTimer _timer;
+
+};
+
 
 
 
@@ -18,6 +18,7 @@ EventDatabasePrivate::EventDatabasePrivate(
     , _data{ data }
     , _activationChangeCallback{ activationChangeCallback }
     , _canUpdateActivationRecordTimer{ new QTimer(this) }
+    , _retentionTimer{ new QTimer(this) }
     , _currentActivation{ 0u }
     , _canUpdateActivationRecord{ false }
 {
@@ -33,6 +34,10 @@ EventDatabasePrivate::EventDatabasePrivate(
             _canUpdateActivationRecordTimer,
             static_cast<void (QTimer::*)()>(&QTimer::start),
             Qt::QueuedConnection);
+    connect(_retentionTimer,
+            &QTimer::timeout,
+            this,
+            &EventDatabasePrivate::processRetention);
 }
 
 QAbstractListModel* EventDatabasePrivate::activations() {
@@ -74,6 +79,15 @@ bool EventDatabasePrivate::canUpdateActivationRecord() const {
     return _canUpdateActivationRecord;
 }
 
+void EventDatabasePrivate::setRetentionInterval(int msec) {
+    Q_ASSERT(QThread::currentThread() == thread());
+    if (msec <= 0) {
+        _retentionTimer->stop();
+        return;
+    }
+    _retentionTimer->start(msec);
+}
+
 void EventDatabasePrivate::denyUpdateActivationRecord() {
     _canUpdateLock.lockForWrite();
     _canUpdateActivationRecord = false;
@@ -85,6 +99,8 @@ void EventDatabasePrivate::denyUpdateActivationRecord() {
     _canUpdateActivationRecordTimer->start();
 }
 
+void EventDatabasePrivate::processRetention() {}
+
 /*******************************************************************
  * Private slots
  ********************************************************************
@@ -46,9 +46,21 @@ protected:
 
     bool canUpdateActivationRecord() const;
 
+    /**
+     * @brief setRetentionInterval
+     * @param msec period of processRetention() calls, 0 stops them
+     */
+    void setRetentionInterval(int msec);
+
 protected slots:
     void denyUpdateActivationRecord();
 
+    /**
+     * @brief processRetention
+     * Called periodically to remove old records
+     */
+    virtual void processRetention();
+
 private slots:
     void processCanUpdateActivation();
     void setCurrentActivation(uint newActivation);
@@ -58,6 +70,7 @@ private:
     QAbstractListModel* _data;
     std::function<void(uint activationIndex)> _activationChangeCallback;
     QTimer* _canUpdateActivationRecordTimer;
+    QTimer* _retentionTimer;
     mutable QReadWriteLock _canUpdateLock;
     uint _currentActivation;
     bool _canUpdateActivationRecord;
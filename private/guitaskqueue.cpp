@@ -0,0 +1,72 @@
+#include "guitaskqueue.h"
+
+#include <QElapsedTimer>
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+GuiTaskQueue::GuiTaskQueue(int timeBudgetMs)
+    : _tasks()
+    , _scheduled{ false }
+    , _backlog{ 0 }
+    , _timeBudgetNs{ qint64(timeBudgetMs) * 1000000 }
+    , _lastDispatchNs{ 0 }
+    , _maxDispatchNs{ 0 }
+    , _lastDispatchedCount{ 0 }
+    , _dispatchCount{ 0u }
+{}
+
+bool GuiTaskQueue::enqueue(Task task) {
+    ++_backlog;
+    _tasks.enqueue(std::move(task));
+    return !_scheduled.exchange(true);
+}
+
+bool GuiTaskQueue::dispatch() {
+    QElapsedTimer timer;
+    timer.start();
+    const auto budget = _timeBudgetNs.load();
+    int count = 0;
+    auto execute = [this, &count](Task& task) {
+        --_backlog;
+        task();
+        ++count;
+    };
+    bool budgetSpent = false;
+    while (!budgetSpent && _tasks.consume(execute, 1u) != 0u) {
+        budgetSpent = timer.nsecsElapsed() >= budget;
+    }
+
+    const auto elapsed = timer.nsecsElapsed();
+    _lastDispatchNs = elapsed;
+    if (elapsed > _maxDispatchNs) {
+        _maxDispatchNs = elapsed;
+    }
+    _lastDispatchedCount = count;
+    ++_dispatchCount;
+
+    if (budgetSpent && !_tasks.isEmpty()) {
+        // Dispatch stays scheduled, yield to event loop
+        return true;
+    }
+    _scheduled = false;
+    // Producer which enqueued before flag reset didnt schedule dispatch
+    return !_tasks.isEmpty() && !_scheduled.exchange(true);
+}
+
+void GuiTaskQueue::setTimeBudget(int ms) {
+    Q_ASSERT(ms > 0);
+    _timeBudgetNs = qint64(ms) * 1000000;
+}
+
+GuiTaskQueue::Statistics GuiTaskQueue::statistics() const {
+    return Statistics {
+        _lastDispatchNs.load(),
+        _maxDispatchNs.load(),
+        _lastDispatchedCount.load(),
+        _backlog.load(),
+        _dispatchCount.load()
+    };
+}
@@ -0,0 +1,81 @@
+#ifndef GUITASKQUEUE_H
+#define GUITASKQUEUE_H
+
+#include <atomic>
+
+#include <QtGlobal>
+
+#include "mpscqueue.h"
+#include "task.h"
+
+/**
+ * @brief The GuiTaskQueue class
+ * Queue of tasks posted to gui thread from other threads.
+ * Wakes gui thread once per burst of tasks and limits time
+ * of one dispatch, so long bursts dont block event loop.
+ * enqueue() is thread-safe, dispatch() is called in gui thread only.
+ */
+class GuiTaskQueue
+{
+public:
+    struct Statistics {
+        /*
+         * Duration of last dispatch in nanoseconds
+         */
+        qint64 lastDispatchNs;
+        /*
+         * Longest dispatch in nanoseconds
+         */
+        qint64 maxDispatchNs;
+        /*
+         * Count of tasks executed by last dispatch
+         */
+        int lastDispatchedCount;
+        /*
+         * Count of tasks waiting for dispatch
+         */
+        int backlog;
+        quint64 dispatchCount;
+    };
+
+    static const int defaultTimeBudgetMs = 4;
+
+    explicit GuiTaskQueue(int timeBudgetMs = defaultTimeBudgetMs);
+
+    /**
+     * @brief enqueue
+     * This method is thread-safe
+     * @return true if dispatch must be scheduled by caller
+     */
+    bool enqueue(Task task);
+
+    /**
+     * @brief dispatch
+     * Executes tasks until queue is empty or time budget is spent
+     * @return true if tasks left and dispatch must be scheduled again
+     */
+    bool dispatch();
+
+    /**
+     * @brief setTimeBudget
+     * Sets maximum duration of one dispatch,
+     * at least one task is executed per dispatch
+     */
+    void setTimeBudget(int ms);
+
+    Statistics statistics() const;
+
+private:
+    MpscQueue<Task> _tasks;
+    std::atomic<bool> _scheduled;
+    std::atomic<int> _backlog;
+    std::atomic<qint64> _timeBudgetNs;
+
+    std::atomic<qint64> _lastDispatchNs;
+    std::atomic<qint64> _maxDispatchNs;
+    std::atomic<int> _lastDispatchedCount;
+    std::atomic<quint64> _dispatchCount;
+
+};
+
+#endif // GUITASKQUEUE_H
@@ -0,0 +1,143 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+/**
+ * @brief The MpscQueue class
+ * Lock-free unbounded multi-producer single-consumer queue.
+ * enqueue() may be called from any thread,
+ * dequeue(), consume() and isEmpty() only from one consumer thread.
+ * Producer does one atomic exchange per value, consumer reads
+ * linked values without atomic read-modify-write, so draining
+ * batch by consume() costs no more than plain list walk.
+ * While producer is between exchange and link, values enqueued
+ * after it are not visible to consumer yet, but they are not lost.
+ * T must be default constructible and movable.
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue();
+    ~MpscQueue();
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief enqueue
+     * This method is thread-safe and lock-free
+     */
+    void enqueue(T value);
+
+    /**
+     * @brief dequeue
+     * @return false if queue is empty
+     */
+    bool dequeue(T& value);
+
+    /**
+     * @brief consume
+     * Dequeues up to maxCount values and passes each to f.
+     * Queue state is updated before f is called,
+     * so f may enqueue to this queue or consume it again.
+     * @return count of consumed values
+     */
+    template <typename F>
+    size_t consume(F f, size_t maxCount = std::numeric_limits<size_t>::max());
+
+    /**
+     * @brief isEmpty
+     * Value enqueued concurrently may be not visible yet
+     */
+    bool isEmpty() const;
+
+private:
+    struct Node {
+        Node() : next{ nullptr }, value() {}
+        explicit Node(T&& v) : next{ nullptr }, value(std::move(v)) {}
+
+        std::atomic<Node*> next;
+        T value;
+    };
+
+private:
+    /*
+     * Producers side: last enqueued node
+     */
+    std::atomic<Node*> _head;
+    /*
+     * Consumer side: node before first not consumed value
+     */
+    Node* _tail;
+    Node _stub;
+
+};
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+template <typename T>
+MpscQueue<T>::MpscQueue()
+    : _head{ &_stub }
+    , _tail{ &_stub }
+    , _stub()
+{}
+
+template <typename T>
+MpscQueue<T>::~MpscQueue() {
+    T value;
+    while (dequeue(value)) {}
+    if (_tail != &_stub) {
+        delete _tail;
+    }
+}
+
+template <typename T>
+void MpscQueue<T>::enqueue(T value) {
+    auto node = new Node(std::move(value));
+    Node* previous = _head.exchange(node, std::memory_order_acq_rel);
+    // Until next is set consumer sees queue ending on previous node
+    previous->next.store(node);
+}
+
+template <typename T>
+bool MpscQueue<T>::dequeue(T& value) {
+    Node* tail = _tail;
+    Node* next = tail->next.load();
+    if (next == nullptr) {
+        return false;
+    }
+    value = std::move(next->value);
+    _tail = next;
+    if (tail != &_stub) {
+        delete tail;
+    }
+    return true;
+}
+
+template <typename T>
+template <typename F>
+size_t MpscQueue<T>::consume(F f, size_t maxCount) {
+    size_t count = 0u;
+    T value;
+    while (count < maxCount && dequeue(value)) {
+        ++count;
+        f(value);
+        value = T();
+    }
+    return count;
+}
+
+template <typename T>
+bool MpscQueue<T>::isEmpty() const {
+    return _tail->next.load() == nullptr;
+}
+
+#endif // MPSCQUEUE_H
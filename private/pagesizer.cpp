@@ -0,0 +1,111 @@
+#include "pagesizer.h"
+
+#include <QMutexLocker>
+
+namespace {
+/*
+ * Weight of last measurement in smoothed read speed
+ */
+const double rateSmoothing = 0.3;
+/*
+ * Page grows or shrinks at most in this factor per fetch
+ */
+const qint64 maxStepFactor = 2;
+}
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+PageSizer::PageSizer(uint pageSize)
+    : _mutex()
+    , _pageSize{ pageSize }
+    , _minPageSize{ DatabaseViewModelDetail::minSizeToFetch }
+    , _maxPageSize{ DatabaseViewModelDetail::maxSizeToFetch }
+    , _targetLatencyNs{ qint64(DatabaseViewModelDetail::targetFetchLatencyMs) * 1000000 }
+    , _rowsPerSecond{ 0.0 }
+    , _lastFetchLatencyNs{ 0 }
+    , _adaptive{ false }
+{
+    Q_ASSERT(pageSize > 0u);
+}
+
+uint PageSizer::pageSize() const {
+    QMutexLocker l(&_mutex);
+    return _pageSize;
+}
+
+void PageSizer::setPageSize(uint pageSize) {
+    Q_ASSERT(pageSize > 0u);
+    QMutexLocker l(&_mutex);
+    _adaptive = false;
+    _pageSize = pageSize;
+}
+
+bool PageSizer::isAdaptive() const {
+    QMutexLocker l(&_mutex);
+    return _adaptive;
+}
+
+void PageSizer::setAdaptive(bool adaptive, uint targetLatencyMs) {
+    Q_ASSERT(targetLatencyMs > 0u);
+    QMutexLocker l(&_mutex);
+    _adaptive = adaptive;
+    _targetLatencyNs = qint64(targetLatencyMs) * 1000000;
+    if (_adaptive) {
+        _pageSize = boundedSize(_pageSize);
+    }
+}
+
+void PageSizer::setLimits(uint minPageSize, uint maxPageSize) {
+    Q_ASSERT(minPageSize > 0u && minPageSize <= maxPageSize);
+    QMutexLocker l(&_mutex);
+    _minPageSize = minPageSize;
+    _maxPageSize = maxPageSize;
+    if (_adaptive) {
+        _pageSize = boundedSize(_pageSize);
+    }
+}
+
+void PageSizer::reportFetch(uint rows, qint64 elapsedNs) {
+    if (rows == 0u || elapsedNs <= 0) {
+        return;
+    }
+    QMutexLocker l(&_mutex);
+    _lastFetchLatencyNs = elapsedNs;
+    const double rate = double(rows) * 1e9 / double(elapsedNs);
+    _rowsPerSecond = qFuzzyIsNull(_rowsPerSecond)
+            ? rate
+            : _rowsPerSecond * (1.0 - rateSmoothing) + rate * rateSmoothing;
+    // Short pages are dominated by query overhead,
+    // they dont say much about speed of large pages
+    if (!_adaptive || rows < _pageSize / 2u) {
+        return;
+    }
+    const auto wanted = qint64(_rowsPerSecond * double(_targetLatencyNs) / 1e9);
+    const auto current = qint64(_pageSize);
+    _pageSize = boundedSize(
+                qBound(current / maxStepFactor,
+                       (current + wanted) / 2,
+                       current * maxStepFactor));
+}
+
+double PageSizer::rowsPerSecond() const {
+    QMutexLocker l(&_mutex);
+    return _rowsPerSecond;
+}
+
+qint64 PageSizer::lastFetchLatencyNs() const {
+    QMutexLocker l(&_mutex);
+    return _lastFetchLatencyNs;
+}
+
+/* ******************************************************************
+ * Private
+ * ******************************************************************
+ */
+
+uint PageSizer::boundedSize(qint64 size) const {
+    return uint(qBound(qint64(_minPageSize), size, qint64(_maxPageSize)));
+}
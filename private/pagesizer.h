@@ -0,0 +1,87 @@
+#ifndef PAGESIZER_H
+#define PAGESIZER_H
+
+#include <QtGlobal>
+#include <QMutex>
+
+#include "databaseviewmodeldetail.h"
+
+/**
+ * @brief The PageSizer class
+ * Chooses count of records fetched by view model at once.
+ * In fixed mode page size is set by user.
+ * In adaptive mode page size follows measured read speed
+ * to keep one fetch near target latency.
+ * This class is thread-safe: reportFetch() is called from
+ * worker thread, setters and getters from gui thread.
+ */
+class PageSizer
+{
+public:
+    explicit PageSizer(uint pageSize = DatabaseViewModelDetail::sizeToFetch);
+
+    /**
+     * @brief pageSize
+     * @return count of records to fetch in next page
+     */
+    uint pageSize() const;
+
+    /**
+     * @brief setPageSize
+     * Sets fixed page size and disables adaptive mode
+     */
+    void setPageSize(uint pageSize);
+
+    bool isAdaptive() const;
+
+    /**
+     * @brief setAdaptive
+     * @param adaptive enables page size adjustment after each fetch
+     * @param targetLatencyMs wanted duration of one page read
+     */
+    void setAdaptive(
+            bool adaptive,
+            uint targetLatencyMs = DatabaseViewModelDetail::targetFetchLatencyMs);
+
+    /**
+     * @brief setLimits
+     * Bounds for page size in adaptive mode
+     */
+    void setLimits(uint minPageSize, uint maxPageSize);
+
+    /**
+     * @brief reportFetch
+     * Called after each page read with measured read duration
+     * @param rows count of read records
+     * @param elapsedNs read duration in nanoseconds
+     */
+    void reportFetch(uint rows, qint64 elapsedNs);
+
+    /**
+     * @brief rowsPerSecond
+     * @return smoothed read speed, 0 if nothing measured
+     */
+    double rowsPerSecond() const;
+
+    /**
+     * @brief lastFetchLatencyNs
+     * @return duration of last page read in nanoseconds
+     */
+    qint64 lastFetchLatencyNs() const;
+
+private:
+    uint boundedSize(qint64 size) const;
+
+private:
+    mutable QMutex _mutex;
+    uint _pageSize;
+    uint _minPageSize;
+    uint _maxPageSize;
+    qint64 _targetLatencyNs;
+    double _rowsPerSecond;
+    qint64 _lastFetchLatencyNs;
+    bool _adaptive;
+
+};
+
+#endif // PAGESIZER_H
@@ -0,0 +1,25 @@
+#include "removalnotifier.h"
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+int RemovalNotifier::addListener(Listener listener) {
+    QMutexLocker l(&_mutex);
+    const auto id = _nextId++;
+    _listeners.insert(id, std::move(listener));
+    return id;
+}
+
+void RemovalNotifier::removeListener(int id) {
+    QMutexLocker l(&_mutex);
+    _listeners.remove(id);
+}
+
+void RemovalNotifier::notify() {
+    QMutexLocker l(&_mutex);
+    for (const auto& listener : qAsConst(_listeners)) {
+        listener();
+    }
+}
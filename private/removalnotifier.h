@@ -0,0 +1,44 @@
+#ifndef REMOVALNOTIFIER_H
+#define REMOVALNOTIFIER_H
+
+#include <functional>
+
+#include <QHash>
+#include <QMutex>
+
+/**
+ * @brief The RemovalNotifier class
+ * Tells views that records were removed in background,
+ * e.g. by size retention of AsyncDatabase.
+ * Shared by database and its views, so view can remove
+ * its listener after database is destroyed.
+ * This class is thread-safe, listeners are called
+ * from thread which removed records
+ */
+class RemovalNotifier
+{
+public:
+    using Listener = std::function<void()>;
+
+    /**
+     * @brief addListener
+     * @return id of listener for removeListener()
+     */
+    int addListener(Listener listener);
+
+    /**
+     * @brief removeListener
+     * Listener is not called after this method returns
+     */
+    void removeListener(int id);
+
+    void notify();
+
+private:
+    QMutex _mutex;
+    QHash<int, Listener> _listeners;
+    int _nextId = 0;
+
+};
+
+#endif // REMOVALNOTIFIER_H
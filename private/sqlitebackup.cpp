@@ -0,0 +1,178 @@
+#include "sqlitebackup.h"
+
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include "../database_detail.h"
+
+namespace {
+int pragmaValue(QSqlDatabase& db, const QString& pragma) {
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA " + pragma) || !query.next()) {
+        return 0;
+    }
+    return query.value(0).toInt();
+}
+} // namespace
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+SqliteBackup::SqliteBackup(QSqlDatabase source, const QString& destinationPath)
+    : _source{ source }
+    , _destinationPath{ destinationPath }
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    , _destination{ nullptr }
+    , _backup{ nullptr }
+#endif
+    , _error()
+    , _pageSize{ 0 }
+    , _totalPages{ 0 }
+    , _remainingPages{ 0 }
+    , _incremental{ false }
+    , _started{ false }
+    , _finished{ false }
+    , _success{ false }
+{}
+
+SqliteBackup::~SqliteBackup() {
+    if (_started && !_finished) {
+        finish(false, "backup aborted");
+    }
+}
+
+bool SqliteBackup::isIncremental(const QSqlDatabase& source) {
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    return DatabaseDetail::sqliteHandle(source) != nullptr;
+#else
+    Q_UNUSED(source);
+    return false;
+#endif
+}
+
+bool SqliteBackup::step(int pages) {
+    if (_finished) {
+        return false;
+    }
+    if (!_started) {
+        start();
+        if (_finished) {
+            return false;
+        }
+    }
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    if (_incremental) {
+        const int result = sqlite3_backup_step(_backup, pages);
+        _remainingPages = sqlite3_backup_remaining(_backup);
+        _totalPages = sqlite3_backup_pagecount(_backup);
+        switch (result) {
+        case SQLITE_DONE:
+            finish(true);
+            return false;
+        case SQLITE_OK:
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+            // Locked pages are copied by next step
+            return true;
+        default:
+            finish(false, sqlite3_errstr(result));
+            return false;
+        }
+    }
+#endif
+    Q_UNUSED(pages);
+    QSqlQuery vacuumQuery(_source);
+    vacuumQuery.prepare("VACUUM INTO ?");
+    vacuumQuery.addBindValue(_destinationPath);
+    if (!vacuumQuery.exec()) {
+        finish(false, vacuumQuery.lastError().text());
+        return false;
+    }
+    _remainingPages = 0;
+    finish(true);
+    return false;
+}
+
+bool SqliteBackup::isFinished() const {
+    return _finished;
+}
+
+bool SqliteBackup::isSuccess() const {
+    return _success;
+}
+
+QString SqliteBackup::errorString() const {
+    return _error;
+}
+
+int SqliteBackup::totalPages() const {
+    return _totalPages;
+}
+
+int SqliteBackup::remainingPages() const {
+    return _remainingPages;
+}
+
+qint64 SqliteBackup::copiedBytes() const {
+    return qint64(_totalPages - _remainingPages) * _pageSize;
+}
+
+/* ******************************************************************
+ * Private
+ * ******************************************************************
+ */
+
+void SqliteBackup::start() {
+    _started = true;
+    if (!_source.isOpen() && !_source.open()) {
+        finish(false, _source.lastError().text());
+        return;
+    }
+    _pageSize = pragmaValue(_source, "page_size");
+    _totalPages = pragmaValue(_source, "page_count");
+    _remainingPages = _totalPages;
+    if (QFile::exists(_destinationPath) && !QFile::remove(_destinationPath)) {
+        finish(false, "can not overwrite " + _destinationPath);
+        return;
+    }
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    auto source = DatabaseDetail::sqliteHandle(_source);
+    _incremental = source != nullptr;
+    if (!_incremental) {
+        return;
+    }
+    if (sqlite3_open_v2(_destinationPath.toUtf8().constData(), &_destination,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr)
+            != SQLITE_OK) {
+        finish(false, sqlite3_errmsg(_destination));
+        return;
+    }
+    _backup = sqlite3_backup_init(_destination, "main", source, "main");
+    if (_backup == nullptr) {
+        finish(false, sqlite3_errmsg(_destination));
+    }
+#endif
+}
+
+void SqliteBackup::finish(bool success, const QString& error) {
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    if (_backup != nullptr) {
+        const int result = sqlite3_backup_finish(_backup);
+        _backup = nullptr;
+        if (success && result != SQLITE_OK) {
+            success = false;
+        }
+    }
+    if (_destination != nullptr) {
+        sqlite3_close(_destination);
+        _destination = nullptr;
+    }
+#endif
+    _finished = true;
+    _success = success;
+    _error = error;
+}
@@ -0,0 +1,82 @@
+#ifndef SQLITEBACKUP_H
+#define SQLITEBACKUP_H
+
+#include <QString>
+#include <QSqlDatabase>
+
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+struct sqlite3;
+struct sqlite3_backup;
+#endif
+
+/**
+ * @brief The SqliteBackup class
+ * Copies database of connection to file while database is in use.
+ * With system SQLite (CONFIG += qtstructdatabase_system_sqlite)
+ * pages are copied by sqlite3 backup API in small steps,
+ * writes of same connection between steps are included into copy.
+ * Otherwise whole copy is made by VACUUM INTO in one step,
+ * it is a read transaction, so in WAL mode it does not block
+ * writes of other connections.
+ * All methods must be called from thread of connection
+ */
+class SqliteBackup
+{
+public:
+    /**
+     * @brief SqliteBackup
+     * @param source opened connection of current thread
+     * @param destinationPath file to write copy to, it is overwritten
+     */
+    SqliteBackup(QSqlDatabase source, const QString& destinationPath);
+    ~SqliteBackup();
+
+    SqliteBackup(const SqliteBackup&) = delete;
+    SqliteBackup& operator=(const SqliteBackup&) = delete;
+
+    /**
+     * @brief isIncremental
+     * @return true if copy of connection is made in steps,
+     * false if it is made by VACUUM INTO at once
+     */
+    static bool isIncremental(const QSqlDatabase& source);
+
+    /**
+     * @brief step
+     * Copies next pages
+     * @param pages count of pages to copy, -1 for all remaining
+     * @return true if backup is not finished
+     */
+    bool step(int pages);
+
+    bool isFinished() const;
+    bool isSuccess() const;
+    QString errorString() const;
+
+    int totalPages() const;
+    int remainingPages() const;
+    qint64 copiedBytes() const;
+
+private:
+    void start();
+    void finish(bool success, const QString& error = QString());
+
+private:
+    QSqlDatabase _source;
+    QString _destinationPath;
+#ifdef QTSTRUCTDATABASE_SYSTEM_SQLITE
+    sqlite3* _destination;
+    sqlite3_backup* _backup;
+#endif
+    QString _error;
+    int _pageSize;
+    int _totalPages;
+    int _remainingPages;
+    bool _incremental;
+    bool _started;
+    bool _finished;
+    bool _success;
+
+};
+
+#endif // SQLITEBACKUP_H
@@ -0,0 +1,89 @@
+#include "stringdictionary.h"
+
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+/* ******************************************************************
+ * Public
+ * ******************************************************************
+ */
+
+QString StringDictionary::tableName() {
+    return "interned_strings";
+}
+
+QString StringDictionary::createTableQuery() {
+    // TEXT affinity, STRING is NUMERIC and would turn "1e3" into 1000.0
+    return "CREATE TABLE IF NOT EXISTS " + tableName()
+            + "(id INTEGER PRIMARY KEY, value TEXT UNIQUE NOT NULL)";
+}
+
+QString StringDictionary::idQuery(const QString& literal) {
+    return "(SELECT id FROM " + tableName() + " WHERE value = " + literal + ")";
+}
+
+qint64 StringDictionary::intern(QSqlDatabase db, const QString& value) {
+    {
+        QReadLocker l(&_lock);
+        const auto it = _ids.constFind(value);
+        if (it != _ids.constEnd()) {
+            return it.value();
+        }
+    }
+    QSqlQuery query(db);
+    query.prepare("INSERT OR IGNORE INTO " + tableName() + "(value) VALUES(?)");
+    query.addBindValue(value);
+    if (!query.exec()) {
+        qDebug() << "can not intern string" << query.lastError().text();
+        return -1;
+    }
+    qint64 id = query.numRowsAffected() > 0 ? query.lastInsertId().toLongLong() : -1;
+    if (id < 0) {
+        query.prepare("SELECT id FROM " + tableName() + " WHERE value = ?");
+        query.addBindValue(value);
+        if (!query.exec() || !query.next()) {
+            qDebug() << "can not find interned string" << query.lastError().text();
+            return -1;
+        }
+        id = query.value(0).toLongLong();
+    }
+    QWriteLocker l(&_lock);
+    _ids.insert(value, id);
+    _values.insert(id, value);
+    return id;
+}
+
+QString StringDictionary::value(QSqlDatabase db, qint64 id) {
+    {
+        QReadLocker l(&_lock);
+        const auto it = _values.constFind(id);
+        if (it != _values.constEnd()) {
+            return it.value();
+        }
+    }
+    QSqlQuery query(db);
+    query.prepare("SELECT value FROM " + tableName() + " WHERE id = ?");
+    query.addBindValue(id);
+    if (!query.exec() || !query.next()) {
+        qDebug() << "unknown interned string" << id << query.lastError().text();
+        return QString();
+    }
+    const auto value = query.value(0).toString();
+    QWriteLocker l(&_lock);
+    // Other thread could cache same string, its data is shared
+    const auto it = _values.constFind(id);
+    if (it != _values.constEnd()) {
+        return it.value();
+    }
+    _ids.insert(value, id);
+    _values.insert(id, value);
+    return value;
+}
+
+void StringDictionary::clear() {
+    QWriteLocker l(&_lock);
+    _ids.clear();
+    _values.clear();
+}
@@ -0,0 +1,61 @@
+#ifndef STRINGDICTIONARY_H
+#define STRINGDICTIONARY_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSqlDatabase>
+#include <QString>
+
+/**
+ * @brief The StringDictionary class
+ * Maps strings of Interned columns to ids stored in dictionary table
+ * and caches both directions, so equal strings read from database
+ * share one QString data.
+ * This class is thread-safe: intern() is called from writer thread,
+ * value() from any thread with own connection
+ */
+class StringDictionary
+{
+public:
+    /**
+     * @brief tableName
+     * Dictionary table of database, it is not counted as table of struct
+     */
+    static QString tableName();
+    static QString createTableQuery();
+
+    /**
+     * @brief idQuery
+     * @param literal SQL literal of string
+     * @return subquery of id of string, e.g. for filters
+     */
+    static QString idQuery(const QString& literal);
+
+    /**
+     * @brief intern
+     * Adds value to dictionary table if needed
+     * @return id of value, -1 on error
+     */
+    qint64 intern(QSqlDatabase db, const QString& value);
+
+    /**
+     * @brief value
+     * @return string of id, null string if id is unknown
+     */
+    QString value(QSqlDatabase db, qint64 id);
+
+    /**
+     * @brief clear
+     * Drops cache, e.g. after rolled back transaction
+     * which could add cached ids
+     */
+    void clear();
+
+private:
+    QReadWriteLock _lock;
+    QHash<QString, qint64> _ids;
+    QHash<qint64, QString> _values;
+
+};
+
+#endif // STRINGDICTIONARY_H
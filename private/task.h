@@ -0,0 +1,65 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <QtGlobal>
+
+/**
+ * @brief The Task class
+ * Move-only callable passed between worker and gui threads.
+ * Unlike std::function it accepts lambdas with move-only captures,
+ * so fetched records can be moved into a task instead of copied.
+ */
+class Task
+{
+public:
+    Task() = default;
+
+    template <
+            typename F,
+            typename = std::enable_if_t<
+                !std::is_same<std::decay_t<F>, Task>{}
+                >
+            >
+    Task(F&& f)
+        : _callable{ new Callable<std::decay_t<F>>(std::forward<F>(f)) }
+    {}
+
+    Task(Task&& other) noexcept = default;
+    Task& operator=(Task&& other) noexcept = default;
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    explicit operator bool() const {
+        return bool(_callable);
+    }
+
+    void operator()() {
+        Q_ASSERT(_callable);
+        _callable->call();
+    }
+
+private:
+    struct Concept {
+        virtual ~Concept() = default;
+        virtual void call() = 0;
+    };
+
+    template <typename F>
+    struct Callable : Concept {
+        explicit Callable(F&& f) : f(std::move(f)) {}
+        explicit Callable(const F& f) : f(f) {}
+        void call() override { f(); }
+        F f;
+    };
+
+private:
+    std::unique_ptr<Concept> _callable;
+
+};
+
+#endif // TASK_H
@@ -1,12 +1,10 @@
 #include "taskedlistmodel.h"
 
-#include <QMutexLocker>
 #include <QCoreApplication>
 
 TaskedListModel::TaskedListModel(QObject* parent)
     : QAbstractListModel(parent)
     , _tasks()
-    , _mutex()
 {
     // object MUST be created in gui thread
     Q_ASSERT(thread()== QCoreApplication::instance()->thread());
@@ -16,20 +14,22 @@ TaskedListModel::TaskedListModel(QObject* parent)
             Qt::ConnectionType::QueuedConnection);
 }
 
-void TaskedListModel::addGuiTask(std::function<void ()> task) {
-    _mutex.lock();
-    _tasks.enqueue(task);
-    _mutex.unlock();
-    emit needProcessGuiTasks();
+void TaskedListModel::addGuiTask(Task task) {
+    if (_tasks.enqueue(std::move(task))) {
+        emit needProcessGuiTasks();
+    }
+}
+
+void TaskedListModel::setGuiTaskTimeBudget(int ms) {
+    _tasks.setTimeBudget(ms);
+}
+
+GuiTaskQueue::Statistics TaskedListModel::guiTaskStatistics() const {
+    return _tasks.statistics();
 }
 
 void TaskedListModel::processGuiTasks() {
-    _mutex.lock();
-    while (!_tasks.isEmpty()) {
-        auto task = _tasks.dequeue();
-        _mutex.unlock();
-        task();
-        _mutex.lock();
+    if (_tasks.dispatch()) {
+        emit needProcessGuiTasks();
     }
-    _mutex.unlock();
 }
@@ -5,7 +5,6 @@
 TaskedObject::TaskedObject(QObject *parent)
     : QObject(parent)
     , _tasks()
-    , _mutex()
 {
     // object MUST be created in gui thread
     Q_ASSERT(thread()== QCoreApplication::instance()->thread());
@@ -15,20 +14,22 @@ TaskedObject::TaskedObject(QObject *parent)
             Qt::ConnectionType::QueuedConnection);
 }
 
-void TaskedObject::addGuiTask(std::function<void ()> task) {
-    _mutex.lock();
-    _tasks.enqueue(task);
-    _mutex.unlock();
-    emit needProcessGuiTasks();
+void TaskedObject::addGuiTask(Task task) {
+    if (_tasks.enqueue(std::move(task))) {
+        emit needProcessGuiTasks();
+    }
+}
+
+void TaskedObject::setGuiTaskTimeBudget(int ms) {
+    _tasks.setTimeBudget(ms);
+}
+
+GuiTaskQueue::Statistics TaskedObject::guiTaskStatistics() const {
+    return _tasks.statistics();
 }
 
 void TaskedObject::processGuiTasks() {
-    _mutex.lock();
-    while (!_tasks.isEmpty()) {
-        auto task = _tasks.dequeue();
-        _mutex.unlock();
-        task();
-        _mutex.lock();
+    if (_tasks.dispatch()) {
+        emit needProcessGuiTasks();
     }
-    _mutex.unlock();
 }
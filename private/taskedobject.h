@@ -1,11 +1,9 @@
 #ifndef TASKEDOBJECT_H
 #define TASKEDOBJECT_H
 
-#include <functional>
-
 #include <QObject>
-#include <QQueue>
-#include <QMutex>
+
+#include "guitaskqueue.h"
 
 class TaskedObject : public QObject
 {
@@ -14,7 +12,20 @@ class TaskedObject : public QObject
 public:
     explicit TaskedObject(QObject *parent = nullptr);
 
-    void addGuiTask(std::function<void()> task);
+    void addGuiTask(Task task);
+
+    /**
+     * @brief setGuiTaskTimeBudget
+     * Sets maximum time of gui tasks processing
+     * before returning to event loop
+     */
+    void setGuiTaskTimeBudget(int ms);
+
+    /**
+     * @brief guiTaskStatistics
+     * @return dispatch time and backlog of gui tasks
+     */
+    GuiTaskQueue::Statistics guiTaskStatistics() const;
 
 public slots:
     void processGuiTasks();
@@ -23,8 +34,7 @@ signals:
     void needProcessGuiTasks();
 
 private:
-    QQueue<std::function<void()>> _tasks;
-    QMutex _mutex;
+    GuiTaskQueue _tasks;
 
 };
 
@@ -1,8 +1,29 @@
 #include "workerthread.h"
 
+#include <chrono>
+
 #include <QMutexLocker>
 #include "QtDebugPrint/debugoutput.h"
 
+namespace {
+/*
+ * Maximum count of tasks drained at once,
+ * abort is checked between batches
+ */
+const size_t tasksBatchSize = 256u;
+
+qint64 nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+void updateMaximum(std::atomic<T>& maximum, T value) {
+    T current = maximum.load();
+    while (current < value && !maximum.compare_exchange_weak(current, value)) {}
+}
+}
+
 /* ******************************************************************
  * Public
  * ******************************************************************
@@ -11,8 +32,28 @@
 WorkerThread::WorkerThread(QObject* parent)
     : QThread(parent)
     , _tasks()
+    , _batchHook()
+    , _idleHook()
     , _mutex()
     , _condition()
+    , _spaceMutex()
+    , _spaceCondition()
+    , _writeBuffer()
+    , _writeBufferMutex()
+    , _capacity{0}
+    , _policy{OverflowPolicy::Block}
+    , _writeDepth{0}
+    , _blockedProducers{0}
+    , _depth{0}
+    , _highWaterMark{0}
+    , _droppedCount{0u}
+    , _rejectedCount{0u}
+    , _executedCount{0u}
+    , _lastTimeInQueueNs{0}
+    , _maxTimeInQueueNs{0}
+    , _totalTimeInQueueNs{0}
+    , _started{false}
+    , _sleeping{false}
     , _needToAbort{false}
 {
 
@@ -20,8 +61,11 @@ WorkerThread::WorkerThread(QObject* parent)
 
 WorkerThread::~WorkerThread() {
 //    dbg << "destruct worker thread";
-    _mutex.lock();
     _needToAbort = true;
+    _spaceMutex.lock();
+    _spaceCondition.wakeAll();
+    _spaceMutex.unlock();
+    _mutex.lock();
 //    dbg << "wakeup thread in destructor for abort";
     _condition.wakeOne();
     _mutex.unlock();
@@ -29,20 +73,77 @@ WorkerThread::~WorkerThread() {
     wait();
 }
 
-void WorkerThread::work(std::function<void()> task) {
-    QMutexLocker l(&_mutex);
-    Q_UNUSED(l);
-//    dbg << "add task";
-    _tasks.enqueue(task);
-
-    if (!isRunning()) {
-//        dbg << "start thread";
-        start();
+bool WorkerThread::work(Task task, TaskType type) {
+    if (type == TaskType::Write && _policy == OverflowPolicy::DropOldest) {
+        enqueueBufferedWrite(std::move(task));
+        return true;
     }
-    else {
-//        dbg << "wakeup thread";
-        _condition.wakeOne();
+    if (type == TaskType::Write && !tryReserveWriteSlot()) {
+        switch (_policy.load()) {
+        case OverflowPolicy::Block:
+            if (!waitForWriteSlot()) {
+                ++_rejectedCount;
+                return false;
+            }
+            break;
+        case OverflowPolicy::DropOldest:
+            // Policy was changed concurrently
+            enqueueBufferedWrite(std::move(task));
+            return true;
+        case OverflowPolicy::DropNewest:
+            ++_droppedCount;
+            return false;
+        case OverflowPolicy::FailFast:
+            ++_rejectedCount;
+            return false;
+        }
     }
+    enqueue(std::move(task), type);
+    return true;
+}
+
+void WorkerThread::setCapacity(int capacity, OverflowPolicy policy) {
+    Q_ASSERT(capacity >= 0);
+    _policy = policy;
+    _capacity = capacity;
+    if (_blockedProducers > 0) {
+        QMutexLocker l(&_spaceMutex);
+        Q_UNUSED(l);
+        _spaceCondition.wakeAll();
+    }
+}
+
+int WorkerThread::capacity() const {
+    return _capacity;
+}
+
+WorkerThread::OverflowPolicy WorkerThread::overflowPolicy() const {
+    return _policy;
+}
+
+void WorkerThread::setWriteBatchHook(BatchHook hook) {
+    Q_ASSERT(!_started);
+    _batchHook = std::move(hook);
+}
+
+void WorkerThread::setIdleHook(IdleHook hook) {
+    Q_ASSERT(!_started);
+    _idleHook = std::move(hook);
+}
+
+WorkerThread::Statistics WorkerThread::statistics() const {
+    const quint64 executed = _executedCount;
+    return Statistics {
+        _depth.load(),
+        _highWaterMark.load(),
+        _writeDepth.load(),
+        _droppedCount.load(),
+        _rejectedCount.load(),
+        executed,
+        _lastTimeInQueueNs.load(),
+        _maxTimeInQueueNs.load(),
+        executed == 0u ? 0 : qint64(quint64(_totalTimeInQueueNs.load()) / executed)
+    };
 }
 
 /* ******************************************************************
@@ -52,24 +153,174 @@ void WorkerThread::work(std::function<void()> task) {
 
 void WorkerThread::run() {
 //    dbg << "run thread";
+    std::vector<QueuedTask> batch;
+    batch.reserve(tasksBatchSize);
     for(;;) {
-        _mutex.lock();
         if (_needToAbort) {
-            _mutex.unlock();
 //            dbg << "exit from run";
             return;
         }
-        auto currentTask = _tasks.dequeue();
-        _mutex.unlock();
-
-        currentTask();
+        _tasks.consume(
+                    [&batch](QueuedTask& task) { batch.push_back(std::move(task)); },
+                    tasksBatchSize);
+        if (!batch.empty()) {
+            executeBatch(batch);
+            batch.clear();
+            continue;
+        }
+        if (_idleHook && _idleHook()) {
+            continue;
+        }
 
-        _mutex.lock();
+        QMutexLocker l(&_mutex);
+        // Producer checks _sleeping after enqueue,
+        // so queue is checked again after _sleeping is set
+        _sleeping = true;
         if (_tasks.isEmpty() && !_needToAbort) {
 //            dbg << "no tasks, thread going to sleep";
             _condition.wait(&_mutex);
         }
-        _mutex.unlock();
+        _sleeping = false;
+    }
+
+}
+
+/* ******************************************************************
+ * Private
+ * ******************************************************************
+ */
+
+void WorkerThread::wakeUp() {
+    if (!_sleeping.exchange(false)) {
+        return;
+    }
+    QMutexLocker l(&_mutex);
+    Q_UNUSED(l);
+    _condition.wakeOne();
+}
+
+void WorkerThread::enqueue(Task&& task, TaskType type) {
+    const auto depth = ++_depth;
+    updateMaximum(_highWaterMark, depth);
+    _tasks.enqueue(QueuedTask{ std::move(task), nowNs(), type });
+
+    if (!_started.exchange(true)) {
+//        dbg << "start thread";
+        start();
+    }
+    else {
+//        dbg << "wakeup thread";
+        wakeUp();
+    }
+}
+
+bool WorkerThread::tryReserveWriteSlot() {
+    int depth = _writeDepth;
+    do {
+        const int capacity = _capacity;
+        if (capacity != 0 && depth >= capacity) {
+            return false;
+        }
+    } while (!_writeDepth.compare_exchange_weak(depth, depth + 1));
+    return true;
+}
+
+bool WorkerThread::waitForWriteSlot() {
+    if (QThread::currentThread() == this) {
+        // Worker can not wait for itself
+        ++_writeDepth;
+        return true;
+    }
+    QMutexLocker l(&_spaceMutex);
+    Q_UNUSED(l);
+    ++_blockedProducers;
+    // Worker checks _blockedProducers after releasing slot,
+    // so slot is reserved again after counter is increased
+    while (!tryReserveWriteSlot()) {
+        if (_needToAbort) {
+            --_blockedProducers;
+            return false;
+        }
+        _spaceCondition.wait(&_spaceMutex);
+    }
+    --_blockedProducers;
+    return true;
+}
+
+void WorkerThread::releaseWriteSlot() {
+    --_writeDepth;
+    if (_blockedProducers > 0) {
+        QMutexLocker l(&_spaceMutex);
+        Q_UNUSED(l);
+        _spaceCondition.wakeOne();
+    }
+}
+
+void WorkerThread::enqueueBufferedWrite(Task&& task) {
+    {
+        QMutexLocker l(&_writeBufferMutex);
+        Q_UNUSED(l);
+        const auto capacity = _capacity.load();
+        const bool full = capacity != 0 && _writeBuffer.size() >= size_t(capacity);
+        if (full) {
+            // Token of discarded task is used by new one
+            _writeBuffer.pop_front();
+            ++_droppedCount;
+        }
+        _writeBuffer.push_back(QueuedTask{ std::move(task), nowNs(), TaskType::Write });
+        if (full) {
+            return;
+        }
+    }
+    ++_writeDepth;
+    enqueue(Task(), TaskType::Write);
+}
+
+bool WorkerThread::takeBufferedWrite(QueuedTask& queuedTask) {
+    QMutexLocker l(&_writeBufferMutex);
+    Q_UNUSED(l);
+    if (_writeBuffer.empty()) {
+        return false;
+    }
+    queuedTask = std::move(_writeBuffer.front());
+    _writeBuffer.pop_front();
+    return true;
+}
+
+void WorkerThread::executeBatch(std::vector<QueuedTask>& batch) {
+    size_t i = 0u;
+    while (i < batch.size()) {
+        if (batch[i].type != TaskType::Write || !_batchHook) {
+            execute(batch[i]);
+            ++i;
+            continue;
+        }
+        auto end = i + 1u;
+        while (end < batch.size() && batch[end].type == TaskType::Write) {
+            ++end;
+        }
+        _batchHook([this, &batch, i, end]() {
+            for (auto j = i; j < end; ++j) {
+                execute(batch[j]);
+            }
+        });
+        i = end;
+    }
+}
+
+void WorkerThread::execute(QueuedTask& queuedTask) {
+    --_depth;
+    if (queuedTask.type == TaskType::Write) {
+        releaseWriteSlot();
+        if (!queuedTask.task && !takeBufferedWrite(queuedTask)) {
+            return;
+        }
     }
+    const auto timeInQueue = nowNs() - queuedTask.enqueuedNs;
+    _lastTimeInQueueNs = timeInQueue;
+    updateMaximum(_maxTimeInQueueNs, timeInQueue);
+    _totalTimeInQueueNs += timeInQueue;
+    ++_executedCount;
 
+    queuedTask.task();
 }
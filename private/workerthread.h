@@ -1,33 +1,193 @@
 #ifndef WORKERTHREAD_H
 #define WORKERTHREAD_H
 
+#include <atomic>
+#include <deque>
 #include <functional>
+#include <vector>
 
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
-#include <QQueue>
+
+#include "mpscqueue.h"
+#include "task.h"
 
 class WorkerThread : public QThread
 {
 public:
+    /**
+     * @brief The TaskType enum
+     * Write tasks are limited by capacity of queue,
+     * common tasks (reads, maintenance) are always queued
+     */
+    enum class TaskType {
+        Common,
+        Write
+    };
+
+    /**
+     * @brief The OverflowPolicy enum
+     * What happens with write task when queue is full
+     */
+    enum class OverflowPolicy {
+        /*
+         * Producer waits for free space
+         */
+        Block,
+        /*
+         * Oldest queued write task is discarded.
+         * In this mode write tasks are kept in mutex guarded buffer,
+         * so discarded task releases its memory at once.
+         * Main queue holds one slot for each buffered write and
+         * new write takes slot of discarded one, so queue stays bounded.
+         * Writes keep their order, but new write runs at position
+         * of discarded write, i.e. before common tasks queued
+         * after discarded write and before new one
+         */
+        DropOldest,
+        /*
+         * New task is discarded
+         */
+        DropNewest,
+        /*
+         * New task is not queued and work() returns false
+         */
+        FailFast
+    };
+
+    struct Statistics {
+        /*
+         * Count of queued tasks
+         */
+        int depth;
+        int highWaterMark;
+        /*
+         * Count of queued write tasks
+         */
+        int writeDepth;
+        quint64 droppedCount;
+        quint64 rejectedCount;
+        quint64 executedCount;
+        qint64 lastTimeInQueueNs;
+        qint64 maxTimeInQueueNs;
+        qint64 averageTimeInQueueNs;
+    };
+
+    /**
+     * Hook receives function which executes one or several
+     * consecutive write tasks, e.g. to wrap them in transaction
+     */
+    using BatchHook = std::function<void(const std::function<void()>& writes)>;
+
+    /**
+     * Hook does one step of background work, e.g. maintenance,
+     * and returns true if more steps remain
+     */
+    using IdleHook = std::function<bool()>;
+
     WorkerThread(QObject* parent = nullptr);
     ~WorkerThread();
 
-    void work(std::function<void()> task);
+    /**
+     * @brief work
+     * Adds task to queue of this thread.
+     * This method is thread-safe and doesnt lock
+     * unless worker thread is sleeping, producer is blocked
+     * or write task is buffered by DropOldest policy
+     * @return false if task was not queued
+     * because of queue overflow
+     */
+    bool work(Task task, TaskType type = TaskType::Common);
+
+    /**
+     * @brief setCapacity
+     * Limits count of queued write tasks
+     * @param capacity maximum count of write tasks, 0 for unbounded queue
+     * @param policy what to do when queue is full
+     */
+    void setCapacity(int capacity, OverflowPolicy policy = OverflowPolicy::Block);
+
+    int capacity() const;
+    OverflowPolicy overflowPolicy() const;
+
+    /**
+     * @brief setWriteBatchHook
+     * Sets hook called for each run of consecutive write tasks
+     * drained together. Must be set before first task is queued
+     */
+    void setWriteBatchHook(BatchHook hook);
+
+    /**
+     * @brief setIdleHook
+     * Sets hook called when queue is empty, before thread sleeps.
+     * While hook returns true it is called again between queued tasks.
+     * Must be set before first task is queued
+     */
+    void setIdleHook(IdleHook hook);
+
+    Statistics statistics() const;
 
 protected:
     void run() override;
 
 private:
-    //void
+    struct QueuedTask {
+        Task task;
+        qint64 enqueuedNs;
+        TaskType type;
+    };
 
 private:
-    QQueue<std::function<void()>> _tasks;
+    void wakeUp();
+    void enqueue(Task&& task, TaskType type);
+    bool tryReserveWriteSlot();
+    bool waitForWriteSlot();
+    void releaseWriteSlot();
+    void enqueueBufferedWrite(Task&& task);
+    bool takeBufferedWrite(QueuedTask& queuedTask);
+    void executeBatch(std::vector<QueuedTask>& batch);
+    void execute(QueuedTask& queuedTask);
+
+private:
+    MpscQueue<QueuedTask> _tasks;
+    BatchHook _batchHook;
+    IdleHook _idleHook;
+    /*
+     * Mutex and condition are used only to sleep when queue is empty
+     */
     QMutex _mutex;
     QWaitCondition _condition;
+    /*
+     * Mutex and condition are used only by producers
+     * blocked on full queue
+     */
+    QMutex _spaceMutex;
+    QWaitCondition _spaceCondition;
+    /*
+     * Write tasks queued with DropOldest policy,
+     * main queue holds empty write task as token for each of them
+     */
+    std::deque<QueuedTask> _writeBuffer;
+    QMutex _writeBufferMutex;
+
+    std::atomic<int> _capacity;
+    std::atomic<OverflowPolicy> _policy;
+    std::atomic<int> _writeDepth;
+    std::atomic<int> _blockedProducers;
+
+    std::atomic<int> _depth;
+    std::atomic<int> _highWaterMark;
+    std::atomic<quint64> _droppedCount;
+    std::atomic<quint64> _rejectedCount;
+    std::atomic<quint64> _executedCount;
+    std::atomic<qint64> _lastTimeInQueueNs;
+    std::atomic<qint64> _maxTimeInQueueNs;
+    std::atomic<qint64> _totalTimeInQueueNs;
 
-    bool _needToAbort;
+    std::atomic<bool> _started;
+    std::atomic<bool> _sleeping;
+    std::atomic<bool> _needToAbort;
 
 };
 
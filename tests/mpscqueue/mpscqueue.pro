@@ -0,0 +1,12 @@
+# MpscQueue does not depend on Qt, test is plain C++
+TEMPLATE = app
+TARGET = tst_mpscqueue
+QT -= core gui
+CONFIG += console c++17 testcase
+CONFIG -= app_bundle
+LIBS += -lpthread
+
+HEADERS += \
+    ../../private/mpscqueue.h
+SOURCES += \
+    tst_mpscqueue.cpp
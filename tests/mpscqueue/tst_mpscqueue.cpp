@@ -0,0 +1,173 @@
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../../private/mpscqueue.h"
+
+/*
+ * MpscQueue does not depend on Qt,
+ * so test is plain C++ without QtTest
+ */
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures; \
+        } \
+    } while (false)
+
+/*
+ * Counts live instances to check that queue destroys values
+ */
+struct Counted {
+    static std::atomic<int> alive;
+
+    Counted() : value{ -1 } { ++alive; }
+    explicit Counted(int v) : value{ v } { ++alive; }
+    Counted(Counted&& other) : value{ other.value } { ++alive; }
+    Counted& operator=(Counted&& other) { value = other.value; return *this; }
+    ~Counted() { --alive; }
+
+    int value;
+};
+std::atomic<int> Counted::alive{ 0 };
+
+void singleThreadOrder() {
+    MpscQueue<int> queue;
+    CHECK(queue.isEmpty());
+    for (int i = 0; i < 1000; ++i) {
+        queue.enqueue(i);
+    }
+    CHECK(!queue.isEmpty());
+    int value = -1;
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(queue.dequeue(value));
+        CHECK(value == i);
+    }
+    CHECK(!queue.dequeue(value));
+    CHECK(queue.isEmpty());
+}
+
+void batchDrain() {
+    MpscQueue<int> queue;
+    for (int i = 0; i < 10; ++i) {
+        queue.enqueue(i);
+    }
+    std::vector<int> batch;
+    const auto append = [&batch](int& v) { batch.push_back(v); };
+    CHECK(queue.consume(append, 3u) == 3u);
+    CHECK((batch == std::vector<int>{ 0, 1, 2 }));
+    batch.clear();
+    CHECK(queue.consume(append) == 7u);
+    CHECK(batch.size() == 7u && batch.front() == 3 && batch.back() == 9);
+    CHECK(queue.consume(append) == 0u);
+}
+
+void enqueueFromConsumer() {
+    MpscQueue<int> queue;
+    queue.enqueue(0);
+    std::vector<int> seen;
+    const auto count = queue.consume([&queue, &seen](int& v) {
+        seen.push_back(v);
+        if (v < 5) {
+            queue.enqueue(v + 1);
+        }
+    });
+    CHECK(count == 6u);
+    CHECK((seen == std::vector<int>{ 0, 1, 2, 3, 4, 5 }));
+}
+
+void moveOnlyValues() {
+    MpscQueue<std::unique_ptr<int>> queue;
+    queue.enqueue(std::make_unique<int>(42));
+    std::unique_ptr<int> value;
+    CHECK(queue.dequeue(value));
+    CHECK(value && *value == 42);
+}
+
+void destroysRemainingValues() {
+    {
+        MpscQueue<Counted> queue;
+        for (int i = 0; i < 100; ++i) {
+            queue.enqueue(Counted(i));
+        }
+        Counted value;
+        CHECK(queue.dequeue(value));
+        CHECK(value.value == 0);
+    }
+    CHECK(Counted::alive == 0);
+}
+
+/*
+ * Several producers enqueue concurrently with consumer draining
+ * in batches. Values of each producer must keep their order
+ * and no value may be lost or duplicated
+ */
+void multiProducer() {
+    const int producers = 8;
+    const int perProducer = 200000;
+    MpscQueue<std::pair<int, int>> queue;
+    std::atomic<int> started{ 0 };
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, &started, p]() {
+            ++started;
+            while (started < producers) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < perProducer; ++i) {
+                queue.enqueue(std::make_pair(p, i));
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    long long received = 0;
+    bool ordered = true;
+    const long long expected = static_cast<long long>(producers) * perProducer;
+    while (received < expected) {
+        const auto count = queue.consume([&next, &ordered](std::pair<int, int>& v) {
+            ordered = ordered && v.second == next[size_t(v.first)];
+            ++next[size_t(v.first)];
+        }, 1024u);
+        received += static_cast<long long>(count);
+        if (count == 0u) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    CHECK(ordered);
+    CHECK(received == expected);
+    for (int p = 0; p < producers; ++p) {
+        CHECK(next[size_t(p)] == perProducer);
+    }
+    CHECK(queue.isEmpty());
+}
+
+} // namespace
+
+int main() {
+    singleThreadOrder();
+    batchDrain();
+    enqueueFromConsumer();
+    moveOnlyValues();
+    destroysRemainingValues();
+    multiProducer();
+    if (failures != 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../../private/mpscqueue.h"
+
+/*
+ * Contention benchmark of MpscQueue.
+ * Several producers enqueue while one consumer drains batches
+ * of tasksBatchSize, as WorkerThread does. MpscQueue is compared
+ * with queue locking mutex on each enqueue and swapping lists
+ * once per batch, and with queue locking mutex on each enqueue
+ * and each dequeue, as task queues did before MpscQueue.
+ * Usage: mpscqueue_benchmark [values per producer]
+ */
+namespace {
+
+const size_t tasksBatchSize = 256u;
+
+struct Value {
+    long long payload;
+    int producer;
+};
+
+/*
+ * Mutex on each enqueue, lists are swapped once per batch
+ */
+template <typename T>
+class SwapLockedQueue
+{
+public:
+    void enqueue(T value) {
+        std::lock_guard<std::mutex> l(_mutex);
+        _queued.push_back(std::move(value));
+    }
+
+    template <typename F>
+    size_t consume(F f, size_t maxCount) {
+        size_t count = 0u;
+        while (count < maxCount) {
+            if (_taken.empty()) {
+                std::lock_guard<std::mutex> l(_mutex);
+                _taken.swap(_queued);
+            }
+            if (_taken.empty()) {
+                break;
+            }
+            f(_taken.front());
+            _taken.pop_front();
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    std::mutex _mutex;
+    std::deque<T> _queued;
+    std::deque<T> _taken;
+};
+
+/*
+ * Mutex on each enqueue and each dequeue
+ */
+template <typename T>
+class LockedQueue
+{
+public:
+    void enqueue(T value) {
+        std::lock_guard<std::mutex> l(_mutex);
+        _queue.push_back(std::move(value));
+    }
+
+    template <typename F>
+    size_t consume(F f, size_t maxCount) {
+        size_t count = 0u;
+        while (count < maxCount) {
+            T value;
+            {
+                std::lock_guard<std::mutex> l(_mutex);
+                if (_queue.empty()) {
+                    break;
+                }
+                value = std::move(_queue.front());
+                _queue.pop_front();
+            }
+            f(value);
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    std::mutex _mutex;
+    std::deque<T> _queue;
+};
+
+/*
+ * @return nanoseconds per value
+ */
+template <typename Queue>
+double run(int producers, long long perProducer) {
+    Queue queue;
+    std::atomic<int> ready{ 0 };
+    std::atomic<bool> go{ false };
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, &ready, &go, p, perProducer]() {
+            ++ready;
+            while (!go) {
+                std::this_thread::yield();
+            }
+            for (long long i = 0; i < perProducer; ++i) {
+                queue.enqueue(Value{ i, p });
+            }
+        });
+    }
+    while (ready < producers) {
+        std::this_thread::yield();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    go = true;
+    const long long expected = perProducer * producers;
+    long long received = 0;
+    long long checksum = 0;
+    while (received < expected) {
+        const auto count = queue.consume(
+                    [&checksum](Value& v) { checksum += v.payload; },
+                    tasksBatchSize);
+        received += static_cast<long long>(count);
+        if (count == 0u) {
+            std::this_thread::yield();
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (checksum != producers * (perProducer * (perProducer - 1) / 2)) {
+        std::printf("wrong checksum\n");
+        std::exit(1);
+    }
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                end - start).count();
+    return double(ns) / double(expected);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const long long perProducer = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    std::printf("hardware threads: %u, values per producer: %lld\n",
+                std::thread::hardware_concurrency(), perProducer);
+    std::printf("%-10s %14s %14s %14s\n",
+                "producers", "MpscQueue", "swap locked", "locked");
+    for (int producers : { 1, 2, 4, 8, 16 }) {
+        const auto lockFree = run<MpscQueue<Value>>(producers, perProducer);
+        const auto swapLocked = run<SwapLockedQueue<Value>>(producers, perProducer);
+        const auto locked = run<LockedQueue<Value>>(producers, perProducer);
+        std::printf("%-10d %11.1f ns %11.1f ns %11.1f ns\n",
+                    producers, lockFree, swapLocked, locked);
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+# Not run by make check, start manually on multicore machine
+TEMPLATE = app
+TARGET = mpscqueue_benchmark
+QT -= core gui
+CONFIG += console c++17 release
+CONFIG -= app_bundle
+LIBS += -lpthread
+
+HEADERS += \
+    ../../private/mpscqueue.h
+SOURCES += \
+    main.cpp
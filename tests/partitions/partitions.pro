@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = tst_partitions
+QT += testlib sql
+QT -= gui
+CONFIG += console c++17 testcase
+CONFIG -= app_bundle
+
+include(../../QtStructDatabase.pri)
+
+SOURCES += \
+    tst_partitions.cpp
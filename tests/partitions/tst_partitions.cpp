@@ -0,0 +1,107 @@
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "../../database.h"
+
+struct Stored {
+    int a;
+};
+
+/*
+ * Partition removal runs under write lock of partitions list,
+ * each test hangs instead of failing if it locks list again
+ */
+class PartitionsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rollsPastMaxPartitions();
+    void removeOldestRecordsRemovesPartition();
+    void removeHalfRecordsKeepsCurrentPartition();
+
+private:
+    static PartitionPolicy activationsPolicy(int maxPartitions);
+    static void addActivations(Database<Stored>& db, int count);
+};
+
+PartitionPolicy PartitionsTest::activationsPolicy(int maxPartitions) {
+    PartitionPolicy policy;
+    policy.maxActivations = 1;
+    policy.maxPartitions = maxPartitions;
+    return policy;
+}
+
+void PartitionsTest::addActivations(Database<Stored>& db, int count) {
+    for (int i = 0; i < count; ++i) {
+        db.notifyActivation();
+        QVERIFY(db.addRecord(Stored{ i }));
+    }
+}
+
+void PartitionsTest::rollsPastMaxPartitions() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Database<Stored> db(
+                dir.filePath("catalog.db"),
+                DatabaseDetail::defaultMaxDatabaseSize,
+                DatabaseOptions(),
+                activationsPolicy(2));
+    QVERIFY(db.isValid());
+
+    addActivations(db, 5);
+
+    QCOMPARE(db.partitionsCount(), 2);
+    QCOMPARE(db.numberOfRecords<0>(), 2u);
+    const auto records = db.read(0, 0);
+    QCOMPARE(records.size(), 2);
+    QCOMPARE(records.at(0).a, 3);
+    QCOMPARE(records.at(1).a, 4);
+}
+
+void PartitionsTest::removeOldestRecordsRemovesPartition() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Database<Stored> db(
+                dir.filePath("catalog.db"),
+                DatabaseDetail::defaultMaxDatabaseSize,
+                DatabaseOptions(),
+                activationsPolicy(0));
+    QVERIFY(db.isValid());
+
+    addActivations(db, 3);
+    QCOMPARE(db.partitionsCount(), 3);
+
+    QCOMPARE(db.removeOldestRecords(100), 1);
+    QCOMPARE(db.partitionsCount(), 2);
+    QCOMPARE(db.removeOldestRecords(100), 1);
+    QCOMPARE(db.partitionsCount(), 1);
+    // Current partition holds live activation, its records are deleted
+    QCOMPARE(db.removeOldestRecords(100), 1);
+    QCOMPARE(db.partitionsCount(), 1);
+    QCOMPARE(db.numberOfRecords<0>(), 0u);
+}
+
+void PartitionsTest::removeHalfRecordsKeepsCurrentPartition() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Database<Stored> db(
+                dir.filePath("catalog.db"),
+                DatabaseDetail::defaultMaxDatabaseSize,
+                DatabaseOptions(),
+                activationsPolicy(0));
+    QVERIFY(db.isValid());
+
+    addActivations(db, 4);
+    QCOMPARE(db.partitionsCount(), 4);
+
+    QVERIFY(db.removeHalfRecords<0>());
+    QCOMPARE(db.partitionsCount(), 2);
+    const auto records = db.read(0, 0);
+    QCOMPARE(records.size(), 2);
+    QCOMPARE(records.at(0).a, 2);
+}
+
+QTEST_GUILESS_MAIN(PartitionsTest)
+
+#include "tst_partitions.moc"
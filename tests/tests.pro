@@ -0,0 +1,5 @@
+TEMPLATE = subdirs
+SUBDIRS += \
+    mpscqueue \
+    mpscqueue_benchmark \
+    partitions
@@ -0,0 +1,99 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <limits>
+
+#include <QDateTime>
+#include <QVariant>
+
+#include "columntraits.h"
+
+/**
+ * @brief The Timestamp class
+ * Point of time as milliseconds since epoch (UTC).
+ * Column has same name and type as QDateTime column,
+ * so QDateTime member can be replaced by Timestamp
+ * without change of database. Unlike QDateTime it costs one
+ * integer per record, QDateTime is built only by toDateTime()
+ */
+class Timestamp
+{
+public:
+    constexpr Timestamp() : _msecs{ invalid } {}
+    constexpr explicit Timestamp(qint64 msecsSinceEpoch) : _msecs{ msecsSinceEpoch } {}
+    Timestamp(const QDateTime& dateTime)
+        : _msecs{ dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : invalid }
+    {}
+
+    static constexpr Timestamp fromMSecsSinceEpoch(qint64 msecs) {
+        return Timestamp(msecs);
+    }
+
+    static Timestamp currentTimestamp() {
+        return Timestamp(QDateTime::currentMSecsSinceEpoch());
+    }
+
+    constexpr bool isValid() const {
+        return _msecs != invalid;
+    }
+
+    constexpr qint64 toMSecsSinceEpoch() const {
+        return _msecs;
+    }
+
+    /**
+     * @brief toDateTime
+     * @return local time, invalid QDateTime for invalid timestamp
+     */
+    QDateTime toDateTime() const {
+        return isValid() ? QDateTime::fromMSecsSinceEpoch(_msecs) : QDateTime();
+    }
+
+    /*
+     * Explicit, so comparisons with QDateTime are not ambiguous,
+     * e.g. QDateTime(record.time) for code written for QDateTime member
+     */
+    explicit operator QDateTime() const {
+        return toDateTime();
+    }
+
+    constexpr bool operator==(const Timestamp& other) const { return _msecs == other._msecs; }
+    constexpr bool operator!=(const Timestamp& other) const { return _msecs != other._msecs; }
+    constexpr bool operator<(const Timestamp& other) const { return _msecs < other._msecs; }
+    constexpr bool operator<=(const Timestamp& other) const { return _msecs <= other._msecs; }
+    constexpr bool operator>(const Timestamp& other) const { return _msecs > other._msecs; }
+    constexpr bool operator>=(const Timestamp& other) const { return _msecs >= other._msecs; }
+
+private:
+    static constexpr qint64 invalid = std::numeric_limits<qint64>::min();
+
+    qint64 _msecs;
+
+};
+
+/*
+ * Same column as QDateTime
+ */
+template <>
+struct ColumnTraits<Timestamp> {
+    static QString typeName() {
+        return ColumnTraits<QDateTime>::typeName();
+    }
+    static QString sqlTypeName() {
+        return "INTEGER";
+    }
+    static QVariant toStored(const Timestamp& value) {
+        return value.isValid() ? QVariant(value.toMSecsSinceEpoch()) : QVariant();
+    }
+    static Timestamp fromStored(const QVariant& value) {
+        return value.isNull() ? Timestamp() : Timestamp(value.toLongLong());
+    }
+    static QString filterLiteral(const Timestamp& value) {
+        return value.isValid() ? QString::number(value.toMSecsSinceEpoch()) : "NULL";
+    }
+    static QVariant toDisplay(const Timestamp& value) {
+        return QVariant(value.toDateTime());
+    }
+};
+
+#endif // TIMESTAMP_H